@@ -26,6 +26,7 @@ LOCAL_SRC_FILES := \
     $(SRCDIR)/core/plugin.c \
     $(SRCDIR)/core/rdp.c \
     $(SRCDIR)/core/screen.c \
+    $(SRCDIR)/core/trace.c \
     $(SRCDIR)/plugin/common/gl_screen.c \
     $(SRCDIR)/plugin/mupen64plus/gfx_m64p.c \
     $(SRCDIR)/plugin/mupen64plus/msg.c \
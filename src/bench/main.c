@@ -0,0 +1,224 @@
+#include "core/headless/headless.h"
+#include "core/headless/replay.h"
+#include "core/n64video.h"
+#include "core/parallel.h"
+#include "core/trace.h"
+#include "core/version.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static const char* stage_names[] = {
+    "parse",
+    "rdp",
+    "vi",
+    "screen"
+};
+
+struct bench_result
+{
+    struct replay_stats replay;
+    struct n64video_stats stats;
+    double elapsed;
+};
+
+static void usage(void)
+{
+    fprintf(stderr,
+        "Usage: " CORE_SIMPLE_NAME "-bench [options] <trace file>...\n"
+        "\n"
+        "Options:\n"
+        "  -w <num>   maximum number of rendering workers (0=use all logical processors)\n"
+        "  -l <num>   number of times to replay each trace per worker count\n"
+        "  -m <num>   VI mode (0=Filtered, 1=Unfiltered, 2=Depth, 3=Coverage)\n"
+        "  -p <num>   number of times waiting workers poll before they sleep\n"
+        "  -b <num>   rendering time per command batch in microseconds (0=fixed size)\n"
+    );
+}
+
+static double time_now(void)
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static bool bench_run(struct n64video_config* config, uint32_t loops, struct bench_result* result)
+{
+    bool ok = true;
+
+    memset(result, 0, sizeof(*result));
+    n64video_init(config);
+
+    // warm up caches and lookup tables with one untimed run
+    replay_reset();
+    if (!replay_trace(&result->replay)) {
+        ok = false;
+    }
+
+    memset(&result->replay, 0, sizeof(result->replay));
+    n64video_flush();
+    n64video_reset_stats();
+
+    double start = time_now();
+
+    for (uint32_t i = 0; ok && i < loops; i++) {
+        replay_reset();
+        ok = replay_trace(&result->replay);
+    }
+
+    n64video_flush();
+
+    result->elapsed = time_now() - start;
+    n64video_get_stats(&result->stats);
+    n64video_close();
+
+    return ok;
+}
+
+static void bench_print(const char* name, const struct bench_result* result, double base_elapsed)
+{
+    uint32_t frames = result->replay.frames ? result->replay.frames : 1;
+
+    printf("%8s %9.2f %9.3f", name, result->replay.frames / result->elapsed,
+        result->elapsed * 1e3 / frames);
+
+    // per-stage times in milliseconds per frame
+    for (uint32_t i = 0; i < N64VIDEO_STAGE_NUM; i++) {
+        printf(" %9.3f", result->stats.time[i] / 1e6 / frames);
+    }
+
+    // worker times summed over all workers
+    printf(" %9.3f %9.3f", result->stats.worker_work_time / 1e6 / frames,
+        result->stats.worker_wait_time / 1e6 / frames);
+
+    // average number of commands per batch
+    printf(" %9.1f", result->stats.batches ?
+        (double)result->stats.batch_cmds / result->stats.batches : 0.0);
+
+    if (base_elapsed > 0) {
+        printf(" %8.2fx", base_elapsed / result->elapsed);
+    }
+
+    printf("\n");
+}
+
+static bool bench_trace(const char* path, uint32_t max_workers, uint32_t loops, enum vi_mode mode,
+    uint32_t spin_count, uint32_t batch_latency)
+{
+    uint32_t rdram_size;
+    if (!trace_read_open(path, &rdram_size)) {
+        fprintf(stderr, "Can't open trace file %s\n", path);
+        return false;
+    }
+
+    headless_set_rdram_size(rdram_size);
+
+    struct n64video_config config;
+    n64video_config_defaults(&config);
+    config.vi.mode = mode;
+    config.spin_count = spin_count;
+    config.batch.latency = batch_latency;
+    config.stats = true;
+
+    struct bench_result result;
+
+    // serial run without any worker threads as reference
+    config.parallel = false;
+    if (!bench_run(&config, loops, &result)) {
+        fprintf(stderr, "Invalid packet in trace file %s\n", path);
+        trace_read_close();
+        return false;
+    }
+
+    printf("%s: %u frames, %u command lists, %llu command words\n", path,
+        result.replay.frames, result.replay.lists,
+        (unsigned long long)result.replay.words);
+
+    printf("%8s %9s %9s", "workers", "fps", "ms/frame");
+    for (uint32_t i = 0; i < N64VIDEO_STAGE_NUM; i++) {
+        printf(" %9s", stage_names[i]);
+    }
+    printf(" %9s %9s %9s %9s\n", "work", "wait", "batch", "speedup");
+
+    bench_print("serial", &result, 0);
+
+    config.parallel = true;
+
+    double base_elapsed = 0;
+    for (uint32_t num_workers = 1; num_workers <= max_workers; num_workers++) {
+        config.num_workers = num_workers;
+        bench_run(&config, loops, &result);
+
+        if (num_workers == 1) {
+            base_elapsed = result.elapsed;
+        }
+
+        char name[16];
+        snprintf(name, sizeof(name), "%u", num_workers);
+        bench_print(name, &result, base_elapsed);
+    }
+
+    printf("\n");
+
+    trace_read_close();
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t max_workers = 0;
+    uint32_t loops = 1;
+    enum vi_mode mode = VI_MODE_NORMAL;
+    int num_traces = 0;
+
+    struct n64video_config defaults;
+    n64video_config_defaults(&defaults);
+    uint32_t spin_count = defaults.spin_count;
+    uint32_t batch_latency = defaults.batch.latency;
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        if (arg[0] != '-') {
+            // move trace paths to the front of argv
+            argv[num_traces++] = argv[i];
+        } else if (i + 1 < argc && !strcmp(arg, "-w")) {
+            max_workers = strtoul(argv[++i], NULL, 0);
+        } else if (i + 1 < argc && !strcmp(arg, "-l")) {
+            loops = strtoul(argv[++i], NULL, 0);
+        } else if (i + 1 < argc && !strcmp(arg, "-m")) {
+            mode = strtol(argv[++i], NULL, 0);
+        } else if (i + 1 < argc && !strcmp(arg, "-p")) {
+            spin_count = strtoul(argv[++i], NULL, 0);
+        } else if (i + 1 < argc && !strcmp(arg, "-b")) {
+            batch_latency = strtoul(argv[++i], NULL, 0);
+        } else {
+            usage();
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (!num_traces || !loops) {
+        usage();
+        return EXIT_FAILURE;
+    }
+
+    // use the same number of workers as the core would select automatically
+    if (!max_workers) {
+        parallel_init(0, 0);
+        max_workers = parallel_num_workers();
+        parallel_close();
+    }
+
+    int ret = EXIT_SUCCESS;
+
+    for (int i = 0; i < num_traces; i++) {
+        if (!bench_trace(argv[i], max_workers, loops, mode, spin_count, batch_latency)) {
+            ret = EXIT_FAILURE;
+        }
+    }
+
+    return ret;
+}
@@ -32,3 +32,13 @@
 #else
 #define STRICTINLINE inline
 #endif
+
+// SIMD instruction sets, only the baseline of each architecture is used so
+// that no extra compiler flags or runtime checks are required
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SIMD_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define SIMD_NEON
+#include <arm_neon.h>
+#endif
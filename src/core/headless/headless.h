@@ -0,0 +1,14 @@
+#pragma once
+
+#include "core/screen.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// plugin and screen backend without any emulator or graphics API, which keeps
+// RDRAM, registers and the last output frame in memory
+
+void headless_set_rdram_size(uint32_t size);
+uint32_t headless_get_num_syncs(void);
+uint32_t headless_get_num_frames(void);
+bool headless_get_frame(struct frame_buffer* fb, int32_t* output_height);
@@ -0,0 +1,38 @@
+#include "core/msg.h"
+#include "core/version.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static void msg_print(const char* type, const char* err, va_list arg)
+{
+    fprintf(stderr, CORE_SIMPLE_NAME ": %s: ", type);
+    vfprintf(stderr, err, arg);
+    fputs("\n", stderr);
+}
+
+void msg_error(const char * err, ...)
+{
+    va_list arg;
+    va_start(arg, err);
+    msg_print("fatal error", err, arg);
+    va_end(arg);
+    exit(EXIT_FAILURE);
+}
+
+void msg_warning(const char* err, ...)
+{
+    va_list arg;
+    va_start(arg, err);
+    msg_print("warning", err, arg);
+    va_end(arg);
+}
+
+void msg_debug(const char* err, ...)
+{
+    va_list arg;
+    va_start(arg, err);
+    msg_print("debug", err, arg);
+    va_end(arg);
+}
@@ -0,0 +1,84 @@
+#include "headless.h"
+
+#include "core/n64video.h"
+#include "core/plugin.h"
+
+#include <stdlib.h>
+
+// DMEM size in 32 bit words
+#define DMEM_WORDS 0x400
+
+static uint8_t rdram[RDRAM_MAX_SIZE];
+static uint32_t rdram_size = RDRAM_MAX_SIZE;
+static uint32_t dmem[DMEM_WORDS];
+
+static uint32_t dp_reg[DP_NUM_REG];
+static uint32_t vi_reg[VI_NUM_REG];
+static uint32_t* dp_reg_ptr[DP_NUM_REG];
+static uint32_t* vi_reg_ptr[VI_NUM_REG];
+
+static uint32_t num_syncs;
+
+void headless_set_rdram_size(uint32_t size)
+{
+    rdram_size = size;
+}
+
+uint32_t headless_get_num_syncs(void)
+{
+    return num_syncs;
+}
+
+void plugin_init(void)
+{
+    for (uint32_t i = 0; i < DP_NUM_REG; i++) {
+        dp_reg_ptr[i] = &dp_reg[i];
+    }
+
+    for (uint32_t i = 0; i < VI_NUM_REG; i++) {
+        vi_reg_ptr[i] = &vi_reg[i];
+    }
+
+    num_syncs = 0;
+}
+
+void plugin_sync_dp(void)
+{
+    // there's no CPU to interrupt, just keep count
+    num_syncs++;
+}
+
+uint32_t** plugin_get_dp_registers(void)
+{
+    return dp_reg_ptr;
+}
+
+uint32_t** plugin_get_vi_registers(void)
+{
+    return vi_reg_ptr;
+}
+
+uint8_t* plugin_get_rdram(void)
+{
+    return rdram;
+}
+
+uint32_t plugin_get_rdram_size(void)
+{
+    return rdram_size;
+}
+
+uint8_t* plugin_get_dmem(void)
+{
+    return (uint8_t*)dmem;
+}
+
+uint8_t* plugin_get_rom_header(void)
+{
+    // there's no ROM loaded
+    return NULL;
+}
+
+void plugin_close(void)
+{
+}
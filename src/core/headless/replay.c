@@ -0,0 +1,147 @@
+#include "replay.h"
+
+#include "core/n64video.h"
+#include "core/plugin.h"
+#include "core/rdp.h"
+#include "core/trace.h"
+
+#include <string.h>
+
+// same as DP_STATUS_XBUS_DMA in the RDP core
+#define DP_STATUS_XBUS_DMA 0x001
+
+// DMEM size in 32 bit words
+#define DMEM_WORDS 0x400
+
+static replay_callback callback;
+
+// current command when processing commands one at a time
+static uint32_t cmd_buf[CMD_MAX_INTS];
+static uint32_t cmd_pos;
+static uint32_t cmd_len;
+
+static void replay_words(const uint32_t* words, uint32_t num_words)
+{
+    uint32_t** dp_reg = plugin_get_dp_registers();
+    uint32_t* dmem = (uint32_t*)plugin_get_dmem();
+
+    memcpy(dmem, words, num_words * sizeof(uint32_t));
+
+    *dp_reg[DP_STATUS] |= DP_STATUS_XBUS_DMA;
+    *dp_reg[DP_START] = *dp_reg[DP_CURRENT] = 0;
+    *dp_reg[DP_END] = num_words * sizeof(uint32_t);
+
+    n64video_process_list();
+}
+
+static void replay_rdram(const struct trace_packet* packet)
+{
+    uint8_t* rdram = plugin_get_rdram();
+    uint32_t num_pages = plugin_get_rdram_size() / TRACE_PAGE_SIZE;
+    const uint32_t* entry = packet->data;
+
+    // pending commands must see the RDRAM contents they were recorded with
+    n64video_flush();
+
+    for (uint32_t i = 0; i < packet->size; i++) {
+        uint32_t page = *entry++;
+        if (page < num_pages) {
+            memcpy(rdram + page * TRACE_PAGE_SIZE, entry, TRACE_PAGE_SIZE);
+        }
+        entry += TRACE_PAGE_SIZE / sizeof(uint32_t);
+    }
+}
+
+static void replay_cmd(const struct trace_packet* packet, struct replay_stats* stats)
+{
+    const uint32_t* words = packet->data;
+    uint32_t num_words = packet->size;
+
+    stats->lists++;
+    stats->words += packet->size;
+
+    if (callback) {
+        // split the list into single commands, which may continue in the next list
+        for (uint32_t i = 0; i < num_words; i++) {
+            if (cmd_pos == 0) {
+                cmd_len = rdp_cmd_length(CMD_ID(&words[i]));
+            }
+
+            cmd_buf[cmd_pos++] = words[i];
+
+            if (cmd_pos == cmd_len) {
+                replay_words(cmd_buf, cmd_len);
+                cmd_pos = 0;
+                stats->cmds++;
+                callback(REPLAY_EVENT_CMD, cmd_buf, stats);
+            }
+        }
+        return;
+    }
+
+    // feed the recorded words through DMEM, which is read by the core the same
+    // way as RDRAM, but doesn't interfere with the RDRAM snapshots
+    while (num_words) {
+        uint32_t len = num_words < DMEM_WORDS ? num_words : DMEM_WORDS;
+        replay_words(words, len);
+        words += len;
+        num_words -= len;
+    }
+}
+
+static void replay_vi(const struct trace_packet* packet, struct replay_stats* stats)
+{
+    uint32_t** vi_reg = plugin_get_vi_registers();
+
+    for (uint32_t i = 0; i < VI_NUM_REG; i++) {
+        *vi_reg[i] = packet->data[i];
+    }
+
+    n64video_update_screen();
+
+    stats->frames++;
+
+    if (callback) {
+        callback(REPLAY_EVENT_VI, NULL, stats);
+    }
+}
+
+bool replay_trace(struct replay_stats* stats)
+{
+    struct trace_packet packet;
+    enum trace_read_result result;
+
+    trace_read_rewind();
+
+    while ((result = trace_read_packet(&packet)) == TRACE_READ_OK) {
+        switch (packet.type) {
+            case TRACE_PACKET_RDRAM:
+                replay_rdram(&packet);
+                break;
+            case TRACE_PACKET_CMD:
+                replay_cmd(&packet, stats);
+                break;
+            case TRACE_PACKET_VI:
+                replay_vi(&packet, stats);
+                break;
+            default:
+                return false;
+        }
+    }
+
+    return result == TRACE_READ_END;
+}
+
+void replay_set_callback(replay_callback _callback)
+{
+    callback = _callback;
+}
+
+void replay_reset(void)
+{
+    cmd_pos = 0;
+
+    // RDRAM packets only contain changed pages, so start from a blank state
+    n64video_flush();
+    memset(plugin_get_rdram(), 0, plugin_get_rdram_size());
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+struct replay_stats
+{
+    uint32_t frames;
+    uint32_t lists;
+    uint64_t words;
+    uint64_t cmds;  // only counted if a callback is set
+};
+
+enum replay_event
+{
+    REPLAY_EVENT_CMD,   // a complete command has been processed
+    REPLAY_EVENT_VI     // a frame has been processed by the VI
+};
+
+// cmd points to the command words for REPLAY_EVENT_CMD and is NULL otherwise
+typedef void (*replay_callback)(enum replay_event event, const uint32_t* cmd,
+    const struct replay_stats* stats);
+
+// if a callback is set, commands are processed one at a time, so the callback
+// can inspect RDRAM after each of them
+void replay_set_callback(replay_callback callback);
+
+// replays all packets of the trace opened with trace_read_open through the
+// core, which must be initialized with the headless backend, returns false if
+// the trace is truncated or corrupt
+bool replay_trace(struct replay_stats* stats);
+
+// clears RDRAM before replaying a trace again
+void replay_reset(void);
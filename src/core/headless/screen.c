@@ -0,0 +1,128 @@
+#include "headless.h"
+
+#include "core/msg.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// copy of the last frame passed to screen_write
+static uint32_t* frame_pixels;
+static uint32_t frame_width;
+static uint32_t frame_height;
+static uint32_t frame_size;
+static int32_t frame_output_height;
+
+static uint32_t num_frames;
+
+uint32_t headless_get_num_frames(void)
+{
+    return num_frames;
+}
+
+bool headless_get_frame(struct frame_buffer* fb, int32_t* output_height)
+{
+    if (!frame_pixels || !frame_width || !frame_height) {
+        return false;
+    }
+
+    fb->pixels = frame_pixels;
+    fb->width = frame_width;
+    fb->height = frame_height;
+    fb->pitch = frame_width;
+
+    if (output_height) {
+        *output_height = frame_output_height;
+    }
+
+    return true;
+}
+
+void screen_init(struct n64video_config* config)
+{
+    (void)config;
+
+    num_frames = 0;
+    frame_width = 0;
+    frame_height = 0;
+}
+
+void screen_swap(bool blank)
+{
+    if (blank) {
+        frame_width = 0;
+        frame_height = 0;
+    }
+
+    num_frames++;
+}
+
+void screen_write(struct frame_buffer* fb, int32_t output_height)
+{
+    uint32_t size = fb->width * fb->height;
+
+    // grow frame buffer if required
+    if (size > frame_size) {
+        uint32_t* pixels = realloc(frame_pixels, size * sizeof(uint32_t));
+        if (!pixels) {
+            msg_error("%s: can't allocate frame buffer", __FUNCTION__);
+        }
+        frame_pixels = pixels;
+        frame_size = size;
+    }
+
+    for (uint32_t y = 0; y < fb->height; y++) {
+        memcpy(frame_pixels + y * fb->width, fb->pixels + y * fb->pitch,
+            fb->width * sizeof(uint32_t));
+    }
+
+    frame_width = fb->width;
+    frame_height = fb->height;
+    frame_output_height = output_height;
+}
+
+void screen_read(struct frame_buffer* fb, bool alpha)
+{
+    fb->width = frame_width;
+    fb->height = frame_height;
+    fb->pitch = frame_width;
+
+    if (!fb->pixels) {
+        return;
+    }
+
+    if (alpha) {
+        memcpy(fb->pixels, frame_pixels, frame_width * frame_height * sizeof(uint32_t));
+        return;
+    }
+
+    // pack to 24 bit RGB, the same layout as glReadPixels with GL_RGB
+    uint8_t* dst = (uint8_t*)fb->pixels;
+    for (uint32_t i = 0; i < frame_width * frame_height; i++) {
+        uint32_t c = frame_pixels[i];
+        *dst++ = (c >> 16) & 0xff;
+        *dst++ = (c >> 8) & 0xff;
+        *dst++ = c & 0xff;
+    }
+}
+
+void screen_set_fullscreen(bool fullscreen)
+{
+    (void)fullscreen;
+}
+
+bool screen_get_fullscreen(void)
+{
+    return false;
+}
+
+void screen_close(void)
+{
+    if (frame_pixels) {
+        free(frame_pixels);
+        frame_pixels = NULL;
+    }
+
+    frame_size = 0;
+    frame_width = 0;
+    frame_height = 0;
+}
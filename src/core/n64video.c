@@ -5,11 +5,13 @@
 #include "msg.h"
 #include "screen.h"
 #include "parallel.h"
+#include "trace.h"
 
 #include <memory.h>
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <time.h>
 
 #define MIN(a, b) (((a) < (b)) ? (a) : (b))
 #define MAX(a, b) (((a) > (b)) ? (a) : (b))
@@ -39,7 +41,32 @@
 // maximum number of commands to buffer for parallel processing
 #define CMD_BUFFER_SIZE 1024
 
+// number of command buffers, so new commands can be buffered while the workers
+// are still busy with the previous ones
+#define CMD_BATCH_COUNT 4
+
+// number of RDP states per worker, each state renders its own scanline bands,
+// so workers that are done with their states early can take over the states
+// of the workers that are still busy
+#define RDP_STATES_PER_WORKER 2
+
+// number of spans that can be buffered for the primitives in the command buffer
+#define SPAN_BUFFER_SIZE 0x10000
+
+// maximum number of spans of a single primitive, including the line after the
+// last one
+#define SPAN_MAX_LINES 1025
+
+// number of TMEM snapshots that can be buffered, one for the initial contents
+// and one for each buffered texture load
+#define TMEM_BUFFER_SIZE 256
+#define TMEM_SIZE 0x1000
+
+// number of different color and Z buffers that can be written within a batch
+#define CMD_MAX_TARGETS 8
+
 static struct rdp_state** rdp_states;
+static uint32_t rdp_num_states;
 static struct n64video_config config;
 static struct plugin_api* plugin;
 
@@ -52,6 +79,51 @@ static struct
 
 static int rdp_pipeline_crashed = 0;
 
+// maximum nesting depth of timed stages, currently only the RDP stage is
+// entered from another stage
+#define STATS_MAX_DEPTH 4
+
+static struct n64video_stats stats;
+static enum n64video_stage stats_stack[STATS_MAX_DEPTH];
+static uint32_t stats_depth;
+static uint64_t stats_last_time;
+
+static uint64_t stats_time(void)
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// stages can be nested, in which case the time is only added to the innermost
+// stage, so the sum of all stages doesn't count anything twice
+static void stats_enter(enum n64video_stage stage)
+{
+    if (!config.stats) {
+        return;
+    }
+
+    uint64_t now = stats_time();
+    if (stats_depth) {
+        stats.time[stats_stack[stats_depth - 1]] += now - stats_last_time;
+    }
+
+    stats_stack[stats_depth++] = stage;
+    stats.count[stage]++;
+    stats_last_time = now;
+}
+
+static void stats_leave(void)
+{
+    if (!config.stats || !stats_depth) {
+        return;
+    }
+
+    uint64_t now = stats_time();
+    stats.time[stats_stack[--stats_depth]] += now - stats_last_time;
+    stats_last_time = now;
+}
+
 static STRICTINLINE int32_t clamp(int32_t value, int32_t min, int32_t max)
 {
     if (value < min)
@@ -68,11 +140,99 @@ static STRICTINLINE uint32_t irand(uint32_t* state)
     return ((*state >> 16) & 0x7fff);
 }
 
+// waits for the workers to finish all queued commands, also used by the VI
+static void cmd_wait(void);
+
 #include "rdp/rdp.c"
 #include "vi/vi.c"
 
-static uint32_t rdp_cmd_buf[CMD_BUFFER_SIZE][CMD_MAX_INTS];
-static uint32_t rdp_cmd_buf_pos;
+// color or Z buffer and the RDRAM range written to it
+struct cmd_target
+{
+    uint32_t address;
+    int size;
+    int width;
+    uint32_t start;
+    uint32_t end;
+};
+
+struct cmd_batch
+{
+    uint32_t cmd_buf[CMD_BUFFER_SIZE][CMD_MAX_INTS];
+    uint32_t cmd_buf_pos;
+
+    // scanline range of each buffered primitive, so workers can skip
+    // primitives that are completely outside of their bands, and the edge
+    // walker output, which is computed only once and then shared by all workers
+    struct
+    {
+        bool prim;
+        int32_t start;
+        int32_t end;
+        struct edgewalker_state ew;
+        uint32_t span_pos;
+        struct prim_spans ps;
+        bool load;
+        uint32_t tmem_pos;
+    } bin[CMD_BUFFER_SIZE];
+
+    // positions of all primitives with at least one scanline
+    uint32_t prims[CMD_BUFFER_SIZE];
+    uint32_t num_prims;
+    uint32_t num_loads;
+    uint32_t num_tex_cmds;
+
+    struct span* span_buf;
+    uint32_t span_buf_pos;
+
+    uint8_t* tmem_buf;
+    uint32_t tmem_buf_pos;
+
+    // color and Z buffers written by the buffered primitives, to find
+    // commands that depend on their output
+    struct cmd_target targets[CMD_MAX_TARGETS];
+    uint32_t num_targets;
+
+    // set if the batch depends on the output of earlier batches, so it may
+    // only start after all of them are done
+    bool barrier;
+
+    // time it took to walk the batch and the time each state took to render
+    // it in nanoseconds
+    uint64_t walk_time;
+    uint64_t* state_time;
+};
+
+// ring of command batches, the emulator thread fills one batch at a time and
+// queues it for the workers, each state renders them in the same order, but
+// independent batches may overlap
+static struct cmd_batch rdp_cmd_batches[CMD_BATCH_COUNT];
+static uint32_t rdp_cmd_batch_pos;
+
+// number of commands after which the current batch is queued and the average
+// rendering time per command in nanoseconds it is derived from
+static uint32_t rdp_cmd_batch_limit;
+static uint64_t rdp_cmd_time;
+
+// edge walker states after the last buffered command
+static struct edgewalker_state rdp_cmd_ew;
+
+// image states after the last buffered command
+static struct
+{
+    uint32_t ti_address;
+    int ti_size;
+    int ti_width;
+    uint32_t fb_address;
+    int fb_size;
+    int fb_width;
+    uint32_t zb_address;
+    bool z_enable;
+} rdp_cmd_img;
+
+// texture loads are done only once by a separate state and the workers
+// reference the resulting TMEM snapshots
+static struct rdp_state* rdp_loader;
 
 static uint32_t rdp_cmd_pos;
 static uint32_t rdp_cmd_id;
@@ -141,26 +301,326 @@ static bool rdp_cmd_sync[] = {
     false, // Set_Env_Color
     false, // Set_Combine
     false, // Set_Texture_Image
-    true,  // Set_Mask_Image
-    true,  // Set_Color_Image
+    false, // Set_Mask_Image
+    false, // Set_Color_Image
 };
 
-static void cmd_run_buffered(uint32_t worker_id)
+static void cmd_load_buffered(struct cmd_batch* batch)
+{
+    // keep the TMEM contents from before the first load for the commands that
+    // precede it, every batch needs its own copy, as the states may still
+    // render earlier batches when the loader reuses their buffers
+    memcpy(batch->tmem_buf, rdp_loader->tmem, TMEM_SIZE);
+
+    if (!batch->num_tex_cmds) {
+        return;
+    }
+
+    uint32_t pos;
+    for (pos = 0; pos < batch->cmd_buf_pos; pos++) {
+        switch (CMD_ID(batch->cmd_buf[pos])) {
+            case CMD_ID_SET_TILE:
+            case CMD_ID_SET_TILE_SIZE:
+            case CMD_ID_SET_TEXTURE_IMAGE:
+                rdp_cmd(rdp_loader, batch->cmd_buf[pos]);
+                break;
+            case CMD_ID_LOAD_TLUT:
+            case CMD_ID_LOAD_BLOCK:
+            case CMD_ID_LOAD_TILE:
+                rdp_cmd(rdp_loader, batch->cmd_buf[pos]);
+                memcpy(batch->tmem_buf + batch->bin[pos].tmem_pos * TMEM_SIZE, rdp_loader->tmem, TMEM_SIZE);
+                break;
+        }
+    }
+}
+
+static void cmd_walk_buffered(uint32_t index, void* arg)
+{
+    struct cmd_batch* batch = arg;
+
+    // the first task runs all texture loads in order, all others walk the
+    // edges of a single primitive
+    if (index == 0) {
+        cmd_load_buffered(batch);
+        return;
+    }
+
+    uint32_t pos = batch->prims[index - 1];
+    int32_t ewdata[CMD_MAX_INTS];
+    edgewalker_input(batch->cmd_buf[pos], batch->bin[pos].ew.cycle_type, ewdata);
+    edgewalker_walk(&batch->bin[pos].ew, ewdata, &batch->bin[pos].ps,
+        batch->span_buf + batch->bin[pos].span_pos, batch->bin[pos].start);
+}
+
+static void cmd_run_buffered(uint32_t state_id, void* arg)
 {
+    struct cmd_batch* batch = arg;
+    struct rdp_state* rdp = rdp_states[state_id];
+    uint64_t start = stats_time();
+
+    // start with the TMEM contents from before the first load
+    rdp->tmem = batch->tmem_buf;
+
     uint32_t pos;
-    for (pos = 0; pos < rdp_cmd_buf_pos; pos++) {
-        rdp_cmd(rdp_states[worker_id], rdp_cmd_buf[pos]);
+    for (pos = 0; pos < batch->cmd_buf_pos; pos++) {
+        if (batch->bin[pos].prim) {
+            if (rdp_owns_lines(rdp, batch->bin[pos].start, batch->bin[pos].end)) {
+                edgewalker_render_shared(rdp, &batch->bin[pos].ps,
+                    batch->span_buf + batch->bin[pos].span_pos, batch->bin[pos].start);
+            }
+        } else if (batch->bin[pos].load) {
+            load_shared(rdp, batch->cmd_buf[pos], batch->tmem_buf + batch->bin[pos].tmem_pos * TMEM_SIZE);
+        } else {
+            rdp_cmd(rdp, batch->cmd_buf[pos]);
+        }
+    }
+
+    batch->state_time[state_id] = stats_time() - start;
+}
+
+static void cmd_walk_batch(void* arg)
+{
+    struct cmd_batch* batch = arg;
+    uint64_t start = stats_time();
+
+    // walk the edges of all buffered primitives and run all texture loads
+    // first, so the states only need to render their own scanlines of each
+    // primitive
+    parallel_for(batch->num_prims + 1, cmd_walk_buffered, batch);
+
+    batch->walk_time = stats_time() - start;
+}
+
+static void cmd_reset_batch(struct cmd_batch* batch)
+{
+    batch->cmd_buf_pos = 0;
+    batch->num_prims = 0;
+    batch->num_loads = 0;
+    batch->num_tex_cmds = 0;
+    batch->span_buf_pos = 0;
+    batch->tmem_buf_pos = 1;
+    batch->num_targets = 0;
+    batch->barrier = false;
+}
+
+// adapts the batch size to the rendering time of a finished batch
+static void cmd_update_batch_limit(const struct cmd_batch* batch, bool idle)
+{
+    if (!config.batch.latency) {
+        rdp_cmd_batch_limit = config.batch.max_cmds;
+        return;
+    }
+
+    if (batch->cmd_buf_pos) {
+        // the states of a batch run in parallel, so the slowest one counts
+        uint64_t time = 0;
+        for (uint32_t i = 0; i < rdp_num_states; i++) {
+            time = MAX(time, batch->state_time[i]);
+        }
+
+        uint64_t cmd_time = (batch->walk_time + time) / batch->cmd_buf_pos;
+        rdp_cmd_time = rdp_cmd_time ? (rdp_cmd_time * 7 + cmd_time) / 8 : cmd_time;
+    }
+
+    if (idle) {
+        // the workers had to wait for the last batch, so the next one should
+        // be small enough to be rendered within the latency, which also
+        // limits the time the emulator waits for the workers at Sync_Full
+        if (rdp_cmd_time) {
+            uint64_t limit = config.batch.latency * 1000ULL / rdp_cmd_time;
+            rdp_cmd_batch_limit = (uint32_t)MIN(limit, config.batch.max_cmds);
+        }
+    } else {
+        // the workers are still busy with earlier batches, so larger batches
+        // don't add latency, but save the overhead of starting each batch
+        rdp_cmd_batch_limit *= 2;
     }
+
+    rdp_cmd_batch_limit = CLAMP(rdp_cmd_batch_limit, config.batch.min_cmds, config.batch.max_cmds);
 }
 
 static void cmd_flush(void)
 {
+    struct cmd_batch* batch = &rdp_cmd_batches[rdp_cmd_batch_pos];
+
     // only run if there's something buffered
-    if (rdp_cmd_buf_pos) {
-        // let workers run all buffered commands in parallel
-        parallel_run(cmd_run_buffered);
-        // reset buffer by starting from the beginning
-        rdp_cmd_buf_pos = 0;
+    if (batch->cmd_buf_pos) {
+        // let workers run all buffered commands in the background
+        bool idle = parallel_num_pending() == 0;
+        parallel_run_group(cmd_walk_batch, cmd_run_buffered, rdp_num_states, batch, batch->barrier);
+
+        stats.batches++;
+        stats.batch_cmds += batch->cmd_buf_pos;
+        if (idle) {
+            stats.idle_batches++;
+        }
+
+        // continue with the next batch as soon as the workers are done with it
+        rdp_cmd_batch_pos = (rdp_cmd_batch_pos + 1) % CMD_BATCH_COUNT;
+        stats_enter(N64VIDEO_STAGE_RDP);
+        parallel_wait(CMD_BATCH_COUNT - 1);
+        stats_leave();
+
+        struct cmd_batch* next = &rdp_cmd_batches[rdp_cmd_batch_pos];
+        cmd_update_batch_limit(next, idle);
+        cmd_reset_batch(next);
+
+        // the command that is currently being read isn't part of the batch
+        // yet and may not even be complete if the list ended in the middle
+        // of it, so move the words that have been read so far to the next one
+        if (rdp_cmd_pos) {
+            memcpy(next->cmd_buf[0], batch->cmd_buf[batch->cmd_buf_pos], rdp_cmd_pos * sizeof(uint32_t));
+        }
+    }
+}
+
+static void cmd_wait(void)
+{
+    // wait until the states have rendered all queued batches
+    if (config.parallel) {
+        stats_enter(N64VIDEO_STAGE_RDP);
+        parallel_wait(0);
+        stats_leave();
+    }
+}
+
+static void cmd_update_images(const uint32_t* args)
+{
+    switch (CMD_ID(args)) {
+        case CMD_ID_SET_TEXTURE_IMAGE:
+            rdp_cmd_img.ti_size = (args[0] >> 19) & 0x3;
+            rdp_cmd_img.ti_width = (args[0] & 0x3ff) + 1;
+            rdp_cmd_img.ti_address = args[1] & 0x0ffffff;
+            break;
+        case CMD_ID_SET_COLOR_IMAGE:
+            rdp_cmd_img.fb_size = (args[0] >> 19) & 0x3;
+            rdp_cmd_img.fb_width = (args[0] & 0x3ff) + 1;
+            rdp_cmd_img.fb_address = args[1] & 0x0ffffff;
+            break;
+        case CMD_ID_SET_MASK_IMAGE:
+            rdp_cmd_img.zb_address = args[1] & 0x0ffffff;
+            break;
+        case CMD_ID_SET_OTHER_MODES:
+            // Z buffer accesses are enabled by z_compare_en or z_update_en
+            rdp_cmd_img.z_enable = ((args[1] >> 4) & 3) != 0;
+            break;
+    }
+}
+
+// sets up the color buffer target of the current color image and the Z
+// buffer target of the current mask image for a primitive and returns the
+// number of targets it writes to
+static uint32_t cmd_prim_targets(int32_t start, int32_t end, struct cmd_target* targets)
+{
+    uint32_t num_targets = 0;
+
+    targets[num_targets].address = rdp_cmd_img.fb_address;
+    targets[num_targets].size = rdp_cmd_img.fb_size;
+    targets[num_targets].width = rdp_cmd_img.fb_width;
+    num_targets++;
+
+    if (rdp_cmd_img.z_enable) {
+        targets[num_targets].address = rdp_cmd_img.zb_address;
+        targets[num_targets].size = PIXEL_SIZE_16BIT;
+        targets[num_targets].width = rdp_cmd_img.fb_width;
+        num_targets++;
+    }
+
+    // spans are clipped to the scissor, but not to the width of the image, so
+    // the pixels of the last line may continue up to the right scissor edge,
+    // which can be several lines further for narrow images, the end includes
+    // one more pixel, so it isn't rounded down for 4 bit images
+    int32_t max_x = rdp_cmd_ew.clip.xl >> 2;
+    for (uint32_t i = 0; i < num_targets; i++) {
+        struct cmd_target* target = &targets[i];
+        target->start = target->address + PIXELS_TO_BYTES(target->width * start, target->size);
+        target->end = target->address + PIXELS_TO_BYTES(target->width * end + max_x + 2, target->size);
+    }
+
+    return num_targets;
+}
+
+static bool cmd_same_layout(const struct cmd_target* a, const struct cmd_target* b)
+{
+    return a->address == b->address && a->size == b->size && a->width == b->width;
+}
+
+static struct cmd_target* cmd_find_target(struct cmd_batch* batch, const struct cmd_target* target)
+{
+    for (uint32_t i = 0; i < batch->num_targets; i++) {
+        if (cmd_same_layout(&batch->targets[i], target)) {
+            return &batch->targets[i];
+        }
+    }
+    return NULL;
+}
+
+// checks if a command depends on the output of the primitives of a batch,
+// which is the case for texture loads that read RDRAM written by them, and
+// for primitives that write RDRAM that is also written through a different
+// color or Z buffer, as the same pixels may then belong to the bands of
+// different states and could be written in the wrong order
+static bool cmd_batch_hazard(const struct cmd_batch* batch, const uint32_t* load_range,
+    const struct cmd_target* targets, uint32_t num_targets)
+{
+    for (uint32_t i = 0; i < batch->num_targets; i++) {
+        const struct cmd_target* other = &batch->targets[i];
+
+        if (load_range && load_range[0] < other->end && other->start < load_range[1]) {
+            return true;
+        }
+
+        for (uint32_t j = 0; j < num_targets; j++) {
+            const struct cmd_target* target = &targets[j];
+            if (!cmd_same_layout(target, other) &&
+                target->start < other->end && other->start < target->end) {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+// checks if a command depends on any batch that may still be rendered
+static bool cmd_pending_hazard(const uint32_t* load_range,
+    const struct cmd_target* targets, uint32_t num_targets)
+{
+    uint32_t num_pending = MIN(parallel_num_pending(), CMD_BATCH_COUNT - 1);
+
+    for (uint32_t i = 1; i <= num_pending; i++) {
+        uint32_t pos = (rdp_cmd_batch_pos + CMD_BATCH_COUNT - i) % CMD_BATCH_COUNT;
+        if (cmd_batch_hazard(&rdp_cmd_batches[pos], load_range, targets, num_targets)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// checks if the targets of a primitive don't fit into a batch anymore
+static bool cmd_targets_full(struct cmd_batch* batch, const struct cmd_target* targets, uint32_t num_targets)
+{
+    uint32_t num_new = 0;
+    for (uint32_t i = 0; i < num_targets; i++) {
+        if (!cmd_find_target(batch, &targets[i])) {
+            num_new++;
+        }
+    }
+
+    return batch->num_targets + num_new > CMD_MAX_TARGETS;
+}
+
+static void cmd_add_targets(struct cmd_batch* batch, const struct cmd_target* targets, uint32_t num_targets)
+{
+    for (uint32_t i = 0; i < num_targets; i++) {
+        struct cmd_target* target = cmd_find_target(batch, &targets[i]);
+        if (target) {
+            target->start = MIN(target->start, targets[i].start);
+            target->end = MAX(target->end, targets[i].end);
+        } else {
+            batch->targets[batch->num_targets++] = targets[i];
+        }
     }
 }
 
@@ -171,19 +631,52 @@ static void cmd_init(void)
     rdp_cmd_len = CMD_MAX_INTS;
 }
 
+static void cmd_trace(uint32_t dp_current_al, uint32_t dp_end_al, bool xbus_dma)
+{
+    uint32_t words[CMD_BUFFER_SIZE];
+    uint32_t* dmem = (uint32_t*)plugin_get_dmem();
+
+    // make sure the RDRAM snapshot includes the output of all previous commands
+    n64video_flush();
+    trace_write_rdram(plugin_get_rdram());
+
+    // record the command words exactly as n64video_process_list will read them
+    while (dp_current_al < dp_end_al) {
+        uint32_t i, num_words = MIN(dp_end_al - dp_current_al, CMD_BUFFER_SIZE);
+
+        for (i = 0; i < num_words; i++) {
+            if (xbus_dma) {
+                words[i] = dmem[dp_current_al++ & 0x3ff];
+            } else {
+                words[i] = rdram_read_idx32(dp_current_al++);
+            }
+        }
+
+        trace_write_cmd(words, num_words);
+    }
+}
+
 void n64video_config_defaults(struct n64video_config* config)
 {
     config->parallel = true;
     config->num_workers = 0;
+    config->spin_count = 1000;
+    config->batch.min_cmds = 64;
+    config->batch.max_cmds = CMD_BUFFER_SIZE;
+    config->batch.latency = 1000;
+    config->trace.path = NULL;
     config->vi.interp = VI_INTERP_NEAREST;
     config->vi.mode = VI_MODE_NORMAL;
     config->vi.widescreen = false;
     config->vi.hide_overscan = false;
+    config->stats = false;
 }
 
-void rdp_init_worker(uint32_t worker_id)
+static void rdp_init_state(uint32_t state_id, void* arg)
 {
-    rdp_create(&rdp_states[worker_id], parallel_num_workers(), worker_id);
+    (void)arg;
+
+    rdp_create(&rdp_states[state_id], rdp_num_states, state_id);
 }
 
 void n64video_init(struct n64video_config* _config)
@@ -212,15 +705,47 @@ void n64video_init(struct n64video_config* _config)
     vi_init();
     cmd_init();
 
+    rdp_cmd_batch_pos = 0;
+    cmd_reset_batch(&rdp_cmd_batches[0]);
+
     rdp_pipeline_crashed = 0;
     memset(&onetimewarnings, 0, sizeof(onetimewarnings));
 
+    n64video_reset_stats();
+    stats_depth = 0;
+
+    // start recording a command trace if requested
+    if (config.trace.path && *config.trace.path) {
+        if (!trace_write_open(config.trace.path, plugin_get_rdram_size())) {
+            msg_warning("Can't open trace file %s", config.trace.path);
+        }
+    }
+
     if (config.parallel) {
-        parallel_init(config.num_workers);
-        rdp_states = calloc(parallel_num_workers(), sizeof(struct rdp_state*));
-        parallel_run(rdp_init_worker);
+        parallel_init(config.num_workers, config.spin_count);
+        rdp_num_states = parallel_num_workers() * RDP_STATES_PER_WORKER;
+        rdp_states = calloc(rdp_num_states, sizeof(struct rdp_state*));
+        parallel_for(rdp_num_states, rdp_init_state, NULL);
+
+        for (uint32_t i = 0; i < CMD_BATCH_COUNT; i++) {
+            rdp_cmd_batches[i].span_buf = malloc(SPAN_BUFFER_SIZE * sizeof(struct span));
+            rdp_cmd_batches[i].tmem_buf = malloc(TMEM_BUFFER_SIZE * TMEM_SIZE);
+            rdp_cmd_batches[i].state_time = calloc(rdp_num_states, sizeof(uint64_t));
+            cmd_reset_batch(&rdp_cmd_batches[i]);
+        }
+
+        edgewalker_get_state(rdp_states[0], &rdp_cmd_ew);
+
+        config.batch.max_cmds = CLAMP(config.batch.max_cmds, 1, CMD_BUFFER_SIZE);
+        config.batch.min_cmds = CLAMP(config.batch.min_cmds, 1, config.batch.max_cmds);
+        rdp_cmd_batch_limit = config.batch.max_cmds;
+        rdp_cmd_time = 0;
+
+        rdp_create(&rdp_loader, 0, 0);
+        memset(&rdp_cmd_img, 0, sizeof(rdp_cmd_img));
     } else {
-        rdp_states = calloc(1, sizeof(struct rdp_state*));
+        rdp_num_states = 1;
+        rdp_states = calloc(rdp_num_states, sizeof(struct rdp_state*));
         rdp_create(&rdp_states[0], 0, 0);
     }
 }
@@ -236,12 +761,19 @@ void n64video_process_list(void)
         return;
     }
 
+    if (trace_write_active()) {
+        cmd_trace(dp_current_al, dp_end_al, (*dp_reg[DP_STATUS] & DP_STATUS_XBUS_DMA) != 0);
+    }
+
+    stats_enter(N64VIDEO_STAGE_PARSE);
+
     // while there's data in the command buffer...
     while (dp_end_al - dp_current_al > 0) {
         uint32_t i, toload;
         bool xbus_dma = (*dp_reg[DP_STATUS] & DP_STATUS_XBUS_DMA) != 0;
         uint32_t* dmem = (uint32_t*)plugin_get_dmem();
-        uint32_t* cmd_buf = rdp_cmd_buf[rdp_cmd_buf_pos];
+        struct cmd_batch* batch = &rdp_cmd_batches[rdp_cmd_batch_pos];
+        uint32_t* cmd_buf = batch->cmd_buf[batch->cmd_buf_pos];
 
         // when reading the first int, extract the command ID and update the buffer length
         if (rdp_cmd_pos == 0) {
@@ -252,11 +784,11 @@ void n64video_process_list(void)
             }
 
             rdp_cmd_id = CMD_ID(cmd_buf);
-            rdp_cmd_len = rdp_commands[rdp_cmd_id].length >> 2;
+            rdp_cmd_len = rdp_cmd_length(rdp_cmd_id);
         }
 
         // copy more data from the N64 to the local command buffer
-        toload = MIN(dp_end_al - dp_current_al, rdp_cmd_len - 1);
+        toload = MIN(dp_end_al - dp_current_al, rdp_cmd_len - rdp_cmd_pos);
 
         if (xbus_dma) {
             for (i = 0; i < toload; i++) {
@@ -274,23 +806,109 @@ void n64video_process_list(void)
             if (config.parallel) {
                 // special case: sync_full always needs to be run in main thread
                 if (rdp_cmd_id == CMD_ID_SYNC_FULL) {
-                    // first, run all pending commands
+                    // first, run all pending commands and wait for them, as
+                    // the CPU may access their output after the interrupt
+                    uint64_t start = stats_time();
                     cmd_flush();
+                    cmd_wait();
+                    stats.sync_full_time += stats_time() - start;
 
                     // parameters are unused, so NULL is fine
                     rdp_sync_full(NULL, NULL);
                 } else {
-                    // increment buffer position
-                    rdp_cmd_buf_pos++;
+                    bool load = rdp_cmd_id == CMD_ID_LOAD_TLUT ||
+                        rdp_cmd_id == CMD_ID_LOAD_BLOCK ||
+                        rdp_cmd_id == CMD_ID_LOAD_TILE;
+
+                    // commands that aren't primitives get an empty scanline range
+                    int32_t start = 0, end = -1;
+                    bool prim = prim_lines(cmd_buf, &start, &end);
+
+                    struct cmd_target targets[2];
+                    uint32_t num_targets = 0;
+                    if (prim && start <= end) {
+                        num_targets = cmd_prim_targets(start, end, targets);
+                    }
+
+                    uint32_t load_range[2];
+                    if (load) {
+                        load_rdram_range(cmd_buf, rdp_cmd_img.ti_address, rdp_cmd_img.ti_width,
+                            rdp_cmd_img.ti_size, &load_range[0], &load_range[1]);
+                    }
+
+                    // texture loads run before the buffered primitives are
+                    // rendered and the states render the buffered commands in
+                    // their own bands, so commands that depend on buffered
+                    // output need a new batch
+                    if ((load || num_targets) &&
+                        (cmd_batch_hazard(batch, load ? load_range : NULL, targets, num_targets) ||
+                        cmd_targets_full(batch, targets, num_targets))) {
+                        cmd_flush();
+                        batch = &rdp_cmd_batches[rdp_cmd_batch_pos];
+                        cmd_buf = batch->cmd_buf[0];
+                    }
+
+                    // batches that don't depend on each other may be rendered
+                    // at the same time, otherwise all earlier ones must be done
+                    if (!batch->barrier && (load || num_targets) &&
+                        cmd_pending_hazard(load ? load_range : NULL, targets, num_targets)) {
+                        batch->barrier = true;
+                    }
+
+                    // the loader also needs to follow the tile and texture
+                    // image states
+                    if (load || rdp_cmd_id == CMD_ID_SET_TILE ||
+                        rdp_cmd_id == CMD_ID_SET_TILE_SIZE ||
+                        rdp_cmd_id == CMD_ID_SET_TEXTURE_IMAGE) {
+                        batch->num_tex_cmds++;
+                    }
+
+                    // sort primitives into scanline bands once for all workers
+                    uint32_t pos = batch->cmd_buf_pos;
+                    batch->bin[pos].prim = prim;
+                    batch->bin[pos].start = start;
+                    batch->bin[pos].end = end;
+                    batch->bin[pos].load = load;
+
+                    if (load) {
+                        // reserve a snapshot for the TMEM contents after the load
+                        batch->bin[pos].tmem_pos = batch->tmem_buf_pos++;
+                        batch->num_loads++;
+                    } else if (!batch->bin[pos].prim) {
+                        // keep track of the states that are required to walk
+                        // the edges of the following primitives and to check
+                        // texture loads
+                        edgewalker_update_state(&rdp_cmd_ew, cmd_buf);
+                        cmd_update_images(cmd_buf);
+                    } else if (batch->bin[pos].start <= batch->bin[pos].end) {
+                        // reserve spans for all scanlines of the primitive
+                        batch->bin[pos].ew = rdp_cmd_ew;
+                        batch->prims[batch->num_prims++] = pos;
+                        batch->bin[pos].span_pos = batch->span_buf_pos;
+                        batch->span_buf_pos += batch->bin[pos].end - batch->bin[pos].start + 2;
+                        cmd_add_targets(batch, targets, num_targets);
+                    }
 
-                    // flush buffer when it is full or when the current command requires a sync
-                    if (rdp_cmd_buf_pos >= CMD_BUFFER_SIZE || rdp_cmd_sync[rdp_cmd_id]) {
+                    // increment buffer position, the command is part of the
+                    // batch now
+                    batch->cmd_buf_pos++;
+                    rdp_cmd_pos = 0;
+
+                    // flush buffer when it has reached the batch size, when
+                    // there may not be enough spans left for the next
+                    // primitive or when the current command requires a sync
+                    if (batch->cmd_buf_pos >= rdp_cmd_batch_limit ||
+                        batch->span_buf_pos > SPAN_BUFFER_SIZE - SPAN_MAX_LINES ||
+                        batch->tmem_buf_pos >= TMEM_BUFFER_SIZE ||
+                        rdp_cmd_sync[rdp_cmd_id]) {
                         cmd_flush();
                     }
                 }
             } else {
                 // run command directly
+                stats_enter(N64VIDEO_STAGE_RDP);
                 rdp_cmd(rdp_states[0], cmd_buf);
+                stats_leave();
             }
 
             // reset current command buffer to prepare for the next one
@@ -298,23 +916,104 @@ void n64video_process_list(void)
         }
     }
 
+    stats_leave();
+
     // update DP registers to indicate that all bytes have been read
     *dp_reg[DP_START] = *dp_reg[DP_CURRENT] = *dp_reg[DP_END];
 }
 
+void n64video_flush(void)
+{
+    if (config.parallel) {
+        cmd_flush();
+        cmd_wait();
+    }
+}
+
+void n64video_get_stats(struct n64video_stats* _stats)
+{
+    *_stats = stats;
+
+    struct parallel_stats worker_stats;
+    parallel_get_stats(&worker_stats);
+    _stats->worker_work_time = worker_stats.work_time;
+    _stats->worker_wait_time = worker_stats.wait_time;
+    _stats->worker_parks = worker_stats.num_parks;
+}
+
+void n64video_reset_stats(void)
+{
+    memset(&stats, 0, sizeof(stats));
+    parallel_reset_stats();
+}
+
+void n64video_get_color_image(struct n64video_image* image)
+{
+    // all workers share the same state, so the first one is enough, once it
+    // has caught up with the queued commands
+    cmd_wait();
+    struct rdp_state* rdp = rdp_states[0];
+
+    image->address = rdp->fb_address;
+    image->width = rdp->fb_width;
+    image->height = (rdp->clip.yl + 3) >> 2;
+    image->size = rdp->fb_size;
+}
+
+void n64video_get_depth_image(struct n64video_image* image)
+{
+    cmd_wait();
+    struct rdp_state* rdp = rdp_states[0];
+
+    // the Z buffer always uses 16 bit pixels and the color image width
+    image->address = rdp->zb_address;
+    image->width = rdp->fb_width;
+    image->height = (rdp->clip.yl + 3) >> 2;
+    image->size = PIXEL_SIZE_16BIT;
+}
+
+uint8_t* n64video_get_hidden_rdram(uint32_t* size)
+{
+    *size = sizeof(rdram_hidden);
+    return rdram_hidden;
+}
+
 void n64video_close(void)
 {
+    trace_write_close();
     vi_close();
     parallel_close();
     plugin_close();
     screen_close();
 
     if (rdp_states) {
-        for (uint32_t i = 0; i < config.num_workers; i++) {
+        for (uint32_t i = 0; i < rdp_num_states; i++) {
             rdp_destroy(rdp_states[i]);
         }
 
         free(rdp_states);
         rdp_states = NULL;
     }
+
+    for (uint32_t i = 0; i < CMD_BATCH_COUNT; i++) {
+        if (rdp_cmd_batches[i].span_buf) {
+            free(rdp_cmd_batches[i].span_buf);
+            rdp_cmd_batches[i].span_buf = NULL;
+        }
+
+        if (rdp_cmd_batches[i].tmem_buf) {
+            free(rdp_cmd_batches[i].tmem_buf);
+            rdp_cmd_batches[i].tmem_buf = NULL;
+        }
+
+        if (rdp_cmd_batches[i].state_time) {
+            free(rdp_cmd_batches[i].state_time);
+            rdp_cmd_batches[i].state_time = NULL;
+        }
+    }
+
+    if (rdp_loader) {
+        rdp_destroy(rdp_loader);
+        rdp_loader = NULL;
+    }
 }
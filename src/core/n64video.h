@@ -53,6 +53,36 @@ enum vi_interp
     VI_INTERP_NUM
 };
 
+enum n64video_stage
+{
+    N64VIDEO_STAGE_PARSE,   // command parsing in n64video_process_list
+    N64VIDEO_STAGE_RDP,     // waiting for the RDP workers to execute commands
+    N64VIDEO_STAGE_VI,      // VI filtering in n64video_update_screen
+    N64VIDEO_STAGE_SCREEN,  // screen output of the VI
+    N64VIDEO_STAGE_NUM
+};
+
+struct n64video_stats
+{
+    uint64_t time[N64VIDEO_STAGE_NUM];  // accumulated time in nanoseconds
+    uint64_t count[N64VIDEO_STAGE_NUM]; // number of times a stage was entered
+    uint64_t worker_work_time;  // time spent by all workers running commands
+    uint64_t worker_wait_time;  // time spent by all workers waiting for work or each other
+    uint64_t worker_parks;      // number of times a worker stopped polling and slept
+    uint64_t batches;           // number of command batches queued for the workers
+    uint64_t batch_cmds;        // number of commands in all queued batches
+    uint64_t idle_batches;      // number of batches queued while the workers were idle
+    uint64_t sync_full_time;    // time spent waiting for the workers at Sync_Full
+};
+
+struct n64video_image
+{
+    uint32_t address;   // RDRAM byte address
+    uint32_t width;     // width in pixels
+    uint32_t height;    // height in pixels, taken from the scissor rectangle
+    uint32_t size;      // pixel size (0=4 bit, 1=8 bit, 2=16 bit, 3=32 bit)
+};
+
 struct n64video_config
 {
     struct {
@@ -61,12 +91,28 @@ struct n64video_config
         bool widescreen;
         bool hide_overscan;
     } vi;
+    struct {
+        const char* path;   // record command trace to this file if set
+    } trace;
     bool parallel;
     uint32_t num_workers;
+    uint32_t spin_count;    // number of times waiting workers poll before they sleep
+    struct {
+        uint32_t min_cmds;  // minimum number of commands per batch
+        uint32_t max_cmds;  // maximum number of commands per batch
+        uint32_t latency;   // rendering time per batch in microseconds (0=always use max_cmds)
+    } batch;
+    bool stats;     // measure time spent in each stage, see n64video_get_stats
 };
 
 void n64video_config_defaults(struct n64video_config* config);
 void n64video_init(struct n64video_config* config);
 void n64video_update_screen(void);
 void n64video_process_list(void);
+void n64video_flush(void);
+void n64video_get_stats(struct n64video_stats* stats);
+void n64video_reset_stats(void);
+void n64video_get_color_image(struct n64video_image* image);
+void n64video_get_depth_image(struct n64video_image* image);
+uint8_t* n64video_get_hidden_rdram(uint32_t* size);
 void n64video_close(void);
@@ -2,44 +2,52 @@
 
 #include <atomic>
 #include <algorithm>
+#include <chrono>
 #include <condition_variable>
 #include <cstdint>
-#include <functional>
+#include <deque>
+#include <memory>
 #include <mutex>
+#include <stdexcept>
 #include <thread>
 #include <vector>
 
 class Parallel
 {
 public:
-    Parallel(std::uint32_t num_workers) :
-        m_num_workers(std::min(num_workers, 64U))
-    {
-        // mask for m_tasks_done when all workers have finished their task
-        // except for worker 0, which runs in the main thread
-        m_all_tasks_done = ((1LL << m_num_workers) - 1) & ~1;
+    typedef void (*TaskFunc)(std::uint32_t, void*);
+    typedef void (*InitFunc)(void*);
 
-        // give workers an empty task
-        m_task = [](std::uint32_t) {};
+    Parallel(std::uint32_t num_workers, std::uint32_t spin_count) :
+        m_num_workers(std::max(num_workers, 1U)),
+        m_spin_count(spin_count),
+        m_worker_states(new WorkerState[m_num_workers])
+    {
+        m_epoch = 0;
+        m_num_parked = 0;
+        m_next_worker = 0;
+        m_group_head = 0;
+        m_init_started = 0;
+        m_init_done = 0;
+        m_num_streams = 0;
         m_accept_work = true;
-        start_work();
 
-        // create worker threads
-        for (std::uint32_t worker_id = 1; worker_id < m_num_workers; worker_id++) {
+        reset_stats();
+
+        // create worker threads, the main thread only hands out work to them,
+        // so it can continue while the workers are busy
+        for (std::uint32_t worker_id = 0; worker_id < m_num_workers; worker_id++) {
             m_workers.emplace_back(std::thread(&Parallel::do_work, this, worker_id));
         }
-
-        // synchronize workers to prepare them for real tasks
-        wait();
     }
 
     ~Parallel() {
         // wait for all workers to finish their current work
-        wait();
+        wait(0);
 
         // exit worker main loops
         m_accept_work = false;
-        start_work();
+        signal();
 
         // join worker threads to make sure they have finished
         for (auto& thread : m_workers) {
@@ -50,21 +58,110 @@ public:
         m_workers.clear();
     }
 
-    void run(std::function<void(std::uint32_t)>&& task) {
+    void run_for(std::uint32_t count, TaskFunc func, void* arg) {
+        if (!count) {
+            return;
+        }
+
+        // the range is split up by the workers that pick it up
+        Group group;
+        group.pending = count;
+        push(Task{ func, arg, 0, count, &group });
+
+        if (t_worker_id < m_num_workers) {
+            // help out until all tasks of the range are done, which also
+            // allows nesting ranges within tasks
+            WorkerState& state = m_worker_states[t_worker_id];
+            while (group.pending) {
+                std::uint64_t epoch = m_epoch;
+
+                Task task;
+                if (find_task(t_worker_id, task)) {
+                    execute(task);
+                    continue;
+                }
+
+                auto start = std::chrono::steady_clock::now();
+                idle(state, [epoch, &group, this] {
+                    return m_epoch != epoch || !group.pending;
+                });
+                state.idle_time += elapsed(start);
+            }
+        } else {
+            idle_main([&group] {
+                return !group.pending;
+            });
+        }
+    }
+
+    void run_group(InitFunc init, TaskFunc func, std::uint32_t count, void* arg, bool barrier) {
         // don't allow more tasks if workers are stopping
         if (!m_accept_work) {
             throw std::runtime_error("Workers are exiting and no longer accept work");
         }
 
-        // prepare task for workers and send signal so they start working
-        m_task = task;
-        start_work();
+        // the streams are set up by the first group, all others must use the
+        // same number of tasks
+        if (!m_group_head) {
+            m_num_streams = count;
+            m_streams.reset(new Stream[count]);
+            for (std::uint32_t i = 0; i < count; i++) {
+                m_streams[i].started = 0;
+                m_streams[i].done = 0;
+            }
+        } else if (count != m_num_streams) {
+            throw std::invalid_argument("All groups must have the same number of tasks");
+        }
+
+        // wait until the group that used the slot before has finished
+        wait(QUEUE_SIZE - 1);
 
-        // run worker 0 directly on main thread
-        m_task(0);
+        // only the main thread writes groups, so the slot can be filled
+        // without holding a lock and is published by advancing the head
+        std::uint64_t head = m_group_head;
+        m_groups[head % QUEUE_SIZE] = QueuedGroup{ init, func, arg, barrier };
+        m_group_head = head + 1;
 
-        // wait for all workers to finish
-        wait();
+        start_init();
+    }
+
+    void wait(std::uint32_t num_pending) {
+        std::uint64_t target = m_group_head;
+        if (target < num_pending) {
+            return;
+        }
+        target -= num_pending;
+
+        idle_main([target, this] {
+            return num_done() >= target;
+        });
+    }
+
+    std::uint32_t num_pending() {
+        return static_cast<std::uint32_t>(m_group_head - num_done());
+    }
+
+    void get_stats(parallel_stats* stats) {
+        stats->work_time = 0;
+        stats->wait_time = 0;
+        stats->num_parks = 0;
+
+        for (std::uint32_t worker_id = 0; worker_id < m_num_workers; worker_id++) {
+            WorkerState& state = m_worker_states[worker_id];
+            stats->work_time += state.work_time;
+            stats->wait_time += state.wait_time;
+            stats->num_parks += state.num_parks;
+        }
+    }
+
+    void reset_stats() {
+        for (std::uint32_t worker_id = 0; worker_id < m_num_workers; worker_id++) {
+            WorkerState& state = m_worker_states[worker_id];
+            state.work_time = 0;
+            state.wait_time = 0;
+            state.num_parks = 0;
+            state.idle_time = 0;
+        }
     }
 
     std::uint32_t num_workers() {
@@ -72,78 +169,350 @@ public:
     }
 
 private:
-    std::function<void(std::uint32_t)> m_task;
+    // maximum number of groups that can be queued, must be a power of two
+    static const std::uint32_t QUEUE_SIZE = 16;
+
+    // set of tasks that a thread waits for
+    struct Group
+    {
+        std::atomic<std::uint32_t> pending;
+    };
+
+    // range of indices that still need to be run
+    struct Task
+    {
+        TaskFunc func;
+        void* arg;
+        std::uint32_t begin;
+        std::uint32_t end;
+        Group* group;
+    };
+
+    struct QueuedGroup
+    {
+        InitFunc init;
+        TaskFunc func;
+        void* arg;
+        bool barrier;
+    };
+
+    // tasks with the same index of all queued groups, which run one after
+    // another, the counters are numbers of groups
+    struct Stream
+    {
+        std::atomic<std::uint64_t> started;
+        std::atomic<std::uint64_t> done;
+    };
+
+    struct WorkerState
+    {
+        // tasks of this worker, the owner takes them from the back and
+        // other workers steal them from the front
+        std::mutex mutex;
+        std::deque<Task> tasks;
+
+        // timing counters in nanoseconds, written by the worker only
+        std::atomic<std::uint64_t> work_time;
+        std::atomic<std::uint64_t> wait_time;
+        std::atomic<std::uint64_t> num_parks;
+        std::uint32_t depth = 0;
+        std::uint64_t idle_time = 0;
+    };
+
+    const std::uint32_t m_num_workers;
+
+    // number of times a waiting thread polls before it goes to sleep
+    const std::uint32_t m_spin_count;
+
+    std::unique_ptr<WorkerState[]> m_worker_states;
     std::vector<std::thread> m_workers;
+
+    // advanced whenever new tasks are available or tasks have finished, so
+    // waiting threads know when to look again
+    std::atomic<std::uint64_t> m_epoch;
+    std::atomic<std::uint32_t> m_num_parked;
     std::mutex m_signal_mutex;
-    std::condition_variable m_signal_work;
-    std::condition_variable m_signal_done;
-    std::atomic<uint64_t> m_tasks_done;
-    std::uint64_t m_all_tasks_done;
+    std::condition_variable m_signal;
+
+    // worker that receives the next range from the main thread
+    std::uint32_t m_next_worker;
+
+    // ring buffer of queued groups with a single producer, which is the main
+    // thread, the init tasks are started one after another in the order the
+    // groups were queued
+    QueuedGroup m_groups[QUEUE_SIZE];
+    std::atomic<std::uint64_t> m_group_head;
+    std::atomic<std::uint64_t> m_init_started;
+    std::atomic<std::uint64_t> m_init_done;
+
+    std::unique_ptr<Stream[]> m_streams;
+    std::uint32_t m_num_streams;
+
     std::atomic<bool> m_accept_work;
-    const std::uint32_t m_num_workers;
 
-    void start_work() {
+    // index of the worker running on the current thread, invalid for all
+    // other threads
+    static thread_local std::uint32_t t_worker_id;
+
+    static std::uint64_t elapsed(std::chrono::steady_clock::time_point start) {
+        auto duration = std::chrono::steady_clock::now() - start;
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+    }
+
+    // polls a condition a limited number of times, which avoids the latency
+    // of sleeping and waking up again if it becomes true soon
+    template <typename Predicate>
+    bool spin(Predicate pred) {
+        for (std::uint32_t i = 0; i < m_spin_count; i++) {
+            if (pred()) {
+                return true;
+            }
+            std::this_thread::yield();
+        }
+        return pred();
+    }
+
+    template <typename Predicate>
+    void park(Predicate pred) {
         std::unique_lock<std::mutex> ul(m_signal_mutex);
+        m_num_parked++;
+        m_signal.wait(ul, pred);
+        m_num_parked--;
+    }
 
-        // clear task bits for all workers
-        m_tasks_done = 0;
+    template <typename Predicate>
+    void idle(WorkerState& state, Predicate pred) {
+        if (!spin(pred)) {
+            state.num_parks++;
+            park(pred);
+        }
+    }
 
-        // wake up all workers
-        m_signal_work.notify_all();
+    template <typename Predicate>
+    void idle_main(Predicate pred) {
+        if (!spin(pred)) {
+            park(pred);
+        }
     }
 
-    void do_work(std::uint32_t worker_id) {
-        const std::uint64_t worker_mask = 1LL << worker_id;
+    // wakes up all threads that wait for tasks or for tasks to finish
+    void signal() {
+        m_epoch++;
 
-        while (m_accept_work) {
-            // do the work
-            m_task(worker_id);
+        if (m_num_parked) {
+            { std::lock_guard<std::mutex> lg(m_signal_mutex); }
+            m_signal.notify_all();
+        }
+    }
 
-            {
-                std::unique_lock<std::mutex> ul(m_signal_mutex);
+    void push(const Task& task) {
+        // workers keep their own tasks, the main thread distributes them
+        std::uint32_t worker_id = t_worker_id;
+        if (worker_id >= m_num_workers) {
+            worker_id = m_next_worker;
+            m_next_worker = (m_next_worker + 1) % m_num_workers;
+        }
 
-                // mark task as done
-                m_tasks_done |= worker_mask;
+        WorkerState& state = m_worker_states[worker_id];
+        {
+            std::lock_guard<std::mutex> lg(state.mutex);
+            state.tasks.push_back(task);
+        }
 
-                // notify main thread
-                m_signal_done.notify_one();
+        signal();
+    }
 
-                // take a break and wait for more work
-                m_signal_work.wait(ul, [worker_mask, this] {
-                    return (m_tasks_done & worker_mask) == 0;
-                });
+    bool find_task(std::uint32_t worker_id, Task& task) {
+        // take the most recent task of this worker first, which is the most
+        // likely one to still be in the cache
+        {
+            WorkerState& state = m_worker_states[worker_id];
+            std::lock_guard<std::mutex> lg(state.mutex);
+            if (!state.tasks.empty()) {
+                task = state.tasks.back();
+                state.tasks.pop_back();
+                return true;
+            }
+        }
+
+        // otherwise steal the oldest task of another worker, which usually
+        // covers the largest range
+        for (std::uint32_t i = 1; i < m_num_workers; i++) {
+            WorkerState& state = m_worker_states[(worker_id + i) % m_num_workers];
+            std::lock_guard<std::mutex> lg(state.mutex);
+            if (!state.tasks.empty()) {
+                task = state.tasks.front();
+                state.tasks.pop_front();
+                return true;
             }
         }
+
+        return false;
     }
 
-    void wait() {
-        // wait for all workers to set their task bits
-        std::unique_lock<std::mutex> ul(m_signal_mutex);
-        m_signal_done.wait(ul, [this] {
-            return m_tasks_done == m_all_tasks_done;
-        });
+    void execute(Task& task) {
+        WorkerState& state = m_worker_states[t_worker_id];
+
+        // keep half of the range for other workers until a single index is left
+        while (task.end - task.begin > 1) {
+            std::uint32_t mid = task.begin + (task.end - task.begin) / 2;
+            push(Task{ task.func, task.arg, mid, task.end, task.group });
+            task.end = mid;
+        }
+
+        // time spent waiting within nested tasks is counted as waiting, not
+        // as work of the outermost task
+        auto start = std::chrono::steady_clock::now();
+        if (!state.depth++) {
+            state.idle_time = 0;
+        }
+
+        task.func(task.begin, task.arg);
+
+        if (!--state.depth) {
+            std::uint64_t task_time = elapsed(start);
+            state.work_time += task_time - state.idle_time;
+            state.wait_time += state.idle_time;
+        }
+
+        // tasks of queued groups are waited for through their counters
+        if (!task.group || --task.group->pending == 0) {
+            signal();
+        }
+    }
+
+    // number of queued groups that have finished all their tasks, which
+    // finish in order, as the tasks of each stream do
+    std::uint64_t num_done() {
+        std::uint64_t done = m_init_done;
+        for (std::uint32_t i = 0; i < m_num_streams; i++) {
+            done = std::min<std::uint64_t>(done, m_streams[i].done);
+        }
+        return done;
+    }
+
+    void start_init() {
+        // start the next init task if there is one and the previous one has
+        // finished, barriers also wait for all tasks of the previous groups,
+        // this may be checked by several threads at the same time
+        std::uint64_t started = m_init_started;
+        while (started < m_group_head && started == m_init_done &&
+            (!m_groups[started % QUEUE_SIZE].barrier || num_done() >= started)) {
+            if (m_init_started.compare_exchange_weak(started, started + 1)) {
+                push(Task{ run_init_task, this, 0, 1, nullptr });
+                return;
+            }
+        }
+    }
+
+    void start_stream(std::uint32_t index) {
+        // start the next task of a stream once the init task of its group and
+        // the task of the previous group have finished
+        Stream& stream = m_streams[index];
+        std::uint64_t started = stream.started;
+        while (started < m_init_done && started == stream.done) {
+            if (stream.started.compare_exchange_weak(started, started + 1)) {
+                push(Task{ run_stream_task, this, index, index + 1, nullptr });
+                return;
+            }
+        }
+    }
+
+    static void run_init_task(std::uint32_t, void* arg) {
+        Parallel* parallel = static_cast<Parallel*>(arg);
+        QueuedGroup& group = parallel->m_groups[parallel->m_init_done % QUEUE_SIZE];
+
+        if (group.init) {
+            group.init(group.arg);
+        }
+
+        parallel->m_init_done++;
+        parallel->start_init();
+
+        for (std::uint32_t i = 0; i < parallel->m_num_streams; i++) {
+            parallel->start_stream(i);
+        }
+    }
+
+    static void run_stream_task(std::uint32_t index, void* arg) {
+        Parallel* parallel = static_cast<Parallel*>(arg);
+        Stream& stream = parallel->m_streams[index];
+        QueuedGroup& group = parallel->m_groups[stream.done % QUEUE_SIZE];
+
+        group.func(index, group.arg);
+
+        stream.done++;
+        parallel->start_stream(index);
+
+        // the last stream to finish a group may allow a barrier to start
+        parallel->start_init();
+    }
+
+    void do_work(std::uint32_t worker_id) {
+        WorkerState& state = m_worker_states[worker_id];
+        t_worker_id = worker_id;
+
+        while (true) {
+            std::uint64_t epoch = m_epoch;
+
+            // do the work
+            Task task;
+            if (find_task(worker_id, task)) {
+                execute(task);
+                continue;
+            }
+
+            // exit if there's no work left and workers are stopping
+            if (!m_accept_work) {
+                break;
+            }
+
+            // take a break and wait for more work
+            auto start = std::chrono::steady_clock::now();
+            idle(state, [epoch, this] {
+                return m_epoch != epoch || !m_accept_work;
+            });
+            state.wait_time += elapsed(start);
+        }
     }
 
     void operator=(const Parallel&) = delete;
     Parallel(const Parallel&) = delete;
 };
 
+thread_local std::uint32_t Parallel::t_worker_id = UINT32_MAX;
+
 // C interface for the Parallel class
 static std::unique_ptr<Parallel> parallel;
 
-void parallel_init(uint32_t num)
+void parallel_init(uint32_t num, uint32_t spin_count)
 {
     // auto-select number of workers based on the number of cores
     if (num == 0) {
         num = std::thread::hardware_concurrency();
     }
 
-    parallel = std::make_unique<Parallel>(num);
+    parallel = std::make_unique<Parallel>(num, spin_count);
 }
 
-void parallel_run(void task(uint32_t))
+void parallel_for(uint32_t count, void task(uint32_t, void*), void* arg)
 {
-    parallel->run(task);
+    parallel->run_for(count, task, arg);
+}
+
+void parallel_run_group(void init(void*), void task(uint32_t, void*), uint32_t count, void* arg, bool barrier)
+{
+    parallel->run_group(init, task, count, arg, barrier);
+}
+
+void parallel_wait(uint32_t num_pending)
+{
+    parallel->wait(num_pending);
+}
+
+uint32_t parallel_num_pending()
+{
+    return parallel->num_pending();
 }
 
 uint32_t parallel_num_workers()
@@ -151,6 +520,22 @@ uint32_t parallel_num_workers()
     return parallel->num_workers();
 }
 
+void parallel_get_stats(struct parallel_stats* stats)
+{
+    if (parallel) {
+        parallel->get_stats(stats);
+    } else {
+        *stats = parallel_stats();
+    }
+}
+
+void parallel_reset_stats()
+{
+    if (parallel) {
+        parallel->reset_stats();
+    }
+}
+
 void parallel_close()
 {
     parallel.reset();
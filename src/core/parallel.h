@@ -4,11 +4,35 @@
 extern "C" {
 #endif
 
+#include <stdbool.h>
 #include <stdint.h>
 
-void parallel_init(uint32_t num);
-void parallel_run(void task(uint32_t));
+struct parallel_stats
+{
+    uint64_t work_time; // time spent by all workers running tasks in nanoseconds
+    uint64_t wait_time; // time spent by all workers waiting for tasks
+    uint64_t num_parks; // number of times a worker stopped polling and slept
+};
+
+// spin_count is the number of times a waiting thread polls before it sleeps
+void parallel_init(uint32_t num, uint32_t spin_count);
+// runs the task once for each index from 0 to count - 1 on any of the workers
+// and waits until all of them are done, may also be called from within tasks
+void parallel_for(uint32_t count, void task(uint32_t, void*), void* arg);
+// queues a group of tasks and returns immediately, init runs first, after the
+// init task of the previous group, then task runs once for each index from 0
+// to count - 1, each after the task with the same index of the previous group,
+// so the tasks of different groups may overlap, unless barrier is set, in
+// which case init also waits for all tasks of all previous groups, count must
+// be the same for all groups
+void parallel_run_group(void init(void*), void task(uint32_t, void*), uint32_t count, void* arg, bool barrier);
+// waits until no more than num_pending queued groups are unfinished
+void parallel_wait(uint32_t num_pending);
+// returns the number of queued groups that are unfinished
+uint32_t parallel_num_pending();
 uint32_t parallel_num_workers();
+void parallel_get_stats(struct parallel_stats* stats);
+void parallel_reset_stats();
 void parallel_close();
 
 #ifdef __cplusplus
@@ -92,3 +92,6 @@ void rdp_set_texture_image(struct rdp_state* rdp, const uint32_t* args);
 void rdp_set_mask_image(struct rdp_state* rdp, const uint32_t* args);
 void rdp_set_color_image(struct rdp_state* rdp, const uint32_t* args);
 void rdp_cmd(struct rdp_state* rdp, const uint32_t* args);
+
+// returns the length of a command in 32 bit integers
+uint32_t rdp_cmd_length(uint32_t cmd_id);
@@ -59,7 +59,8 @@ static INLINE void set_blender_input(struct rdp_state* rdp, int cycle, int which
     {
         switch (b & 0x3)
         {
-            case 0:     *input_a = &rdp->inv_pixel_color.a; break;
+            // 1 - A, the inverse alpha kernel derives it from the first alpha input
+            case 0:     *input_a = NULL; break;
             case 1:     *input_a = &rdp->memory_color.a; break;
             case 2:     *input_a = &blenderone; break;
             case 3:     *input_a = &zero_color; break;
@@ -87,90 +88,48 @@ static STRICTINLINE int alpha_compare(struct rdp_state* rdp, int32_t comb_alpha)
     }
 }
 
-static STRICTINLINE void blender_equation_cycle0(struct rdp_state* rdp, int* r, int* g, int* b)
+static STRICTINLINE void blender_equation(struct rdp_state* rdp, int cycle, int shifta, int shiftb, int hwaccurate, int* r, int* g, int* b)
 {
     int blend1a, blend2a;
     int blr, blg, blb, sum;
-    blend1a = *rdp->blender1b_a[0] >> 3;
-    blend2a = *rdp->blender2b_a[0] >> 3;
 
-    int mulb;
-
-
-
-    if (rdp->blender2b_a[0] == &rdp->memory_color.a)
+    switch (rdp->blender_kernel[cycle])
     {
-        blend1a = (blend1a >> rdp->blshifta) & 0x3C;
-        blend2a = (blend2a >> rdp->blshiftb) | 3;
-    }
-
-    mulb = blend2a + 1;
-
-
-    blr = (*rdp->blender1a_r[0]) * blend1a + (*rdp->blender2a_r[0]) * mulb;
-    blg = (*rdp->blender1a_g[0]) * blend1a + (*rdp->blender2a_g[0]) * mulb;
-    blb = (*rdp->blender1a_b[0]) * blend1a + (*rdp->blender2a_b[0]) * mulb;
-
-
-
-    if (!rdp->other_modes.force_blend)
-    {
-
-
-
-
-
-        sum = ((blend1a & ~3) + (blend2a & ~3) + 4) << 9;
-        *r = bldiv_hwaccurate_table[sum | ((blr >> 2) & 0x7ff)];
-        *g = bldiv_hwaccurate_table[sum | ((blg >> 2) & 0x7ff)];
-        *b = bldiv_hwaccurate_table[sum | ((blb >> 2) & 0x7ff)];
-    }
-    else
-    {
-        *r = (blr >> 5) & 0xff;
-        *g = (blg >> 5) & 0xff;
-        *b = (blb >> 5) & 0xff;
-    }
-}
-
-static STRICTINLINE void blender_equation_cycle0_2(struct rdp_state* rdp, int* r, int* g, int* b)
-{
-    int blend1a, blend2a;
-    blend1a = *rdp->blender1b_a[0] >> 3;
-    blend2a = *rdp->blender2b_a[0] >> 3;
+        case BLENDER_KERNEL_PASS:
+        {
+            // weights of 0 and 32, the divider passes the second input through
+            *r = *rdp->blender2a_r[cycle];
+            *g = *rdp->blender2a_g[cycle];
+            *b = *rdp->blender2a_b[cycle];
+            return;
+        }
 
-    if (rdp->blender2b_a[0] == &rdp->memory_color.a)
-    {
-        blend1a = (blend1a >> rdp->pastblshifta) & 0x3C;
-        blend2a = (blend2a >> rdp->pastblshiftb) | 3;
+        case BLENDER_KERNEL_INV_ALPHA:
+        {
+            // the weights always add up to 32, for which the divider is exact
+            blend1a = *rdp->blender1b_a[cycle] >> 3;
+            blend2a = 32 - blend1a;
+            *r = (((*rdp->blender1a_r[cycle]) * blend1a + (*rdp->blender2a_r[cycle]) * blend2a) >> 5) & 0xff;
+            *g = (((*rdp->blender1a_g[cycle]) * blend1a + (*rdp->blender2a_g[cycle]) * blend2a) >> 5) & 0xff;
+            *b = (((*rdp->blender1a_b[cycle]) * blend1a + (*rdp->blender2a_b[cycle]) * blend2a) >> 5) & 0xff;
+            return;
+        }
     }
 
-    blend2a += 1;
-    *r = (((*rdp->blender1a_r[0]) * blend1a + (*rdp->blender2a_r[0]) * blend2a) >> 5) & 0xff;
-    *g = (((*rdp->blender1a_g[0]) * blend1a + (*rdp->blender2a_g[0]) * blend2a) >> 5) & 0xff;
-    *b = (((*rdp->blender1a_b[0]) * blend1a + (*rdp->blender2a_b[0]) * blend2a) >> 5) & 0xff;
-}
+    blend1a = *rdp->blender1b_a[cycle] >> 3;
+    blend2a = *rdp->blender2b_a[cycle] >> 3;
 
-static STRICTINLINE void blender_equation_cycle1(struct rdp_state* rdp, int* r, int* g, int* b)
-{
-    int blend1a, blend2a;
-    int blr, blg, blb, sum;
-    blend1a = *rdp->blender1b_a[1] >> 3;
-    blend2a = *rdp->blender2b_a[1] >> 3;
-
-    int mulb;
-    if (rdp->blender2b_a[1] == &rdp->memory_color.a)
+    if (rdp->blender_kernel[cycle] == BLENDER_KERNEL_MEMORY)
     {
-        blend1a = (blend1a >> rdp->blshifta) & 0x3C;
-        blend2a = (blend2a >> rdp->blshiftb) | 3;
+        blend1a = (blend1a >> shifta) & 0x3C;
+        blend2a = (blend2a >> shiftb) | 3;
     }
 
-    mulb = blend2a + 1;
-    blr = (*rdp->blender1a_r[1]) * blend1a + (*rdp->blender2a_r[1]) * mulb;
-    blg = (*rdp->blender1a_g[1]) * blend1a + (*rdp->blender2a_g[1]) * mulb;
-    blb = (*rdp->blender1a_b[1]) * blend1a + (*rdp->blender2a_b[1]) * mulb;
+    blr = (*rdp->blender1a_r[cycle]) * blend1a + (*rdp->blender2a_r[cycle]) * (blend2a + 1);
+    blg = (*rdp->blender1a_g[cycle]) * blend1a + (*rdp->blender2a_g[cycle]) * (blend2a + 1);
+    blb = (*rdp->blender1a_b[cycle]) * blend1a + (*rdp->blender2a_b[cycle]) * (blend2a + 1);
 
-    if (!rdp->other_modes.force_blend)
+    if (hwaccurate)
     {
         sum = ((blend1a & ~3) + (blend2a & ~3) + 4) << 9;
         *r = bldiv_hwaccurate_table[sum | ((blr >> 2) & 0x7ff)];
@@ -212,13 +171,7 @@ static STRICTINLINE int blender_1cycle(struct rdp_state* rdp, uint32_t* fr, uint
                 }
                 else
                 {
-                    rdp->inv_pixel_color.a =  (~(*rdp->blender1b_a[0])) & 0xff;
-
-
-
-
-
-                    blender_equation_cycle0(rdp, &r, &g, &b);
+                    blender_equation(rdp, 0, rdp->blshifta, rdp->blshiftb, !rdp->other_modes.force_blend, &r, &g, &b);
                 }
             }
             else
@@ -250,9 +203,7 @@ static STRICTINLINE int blender_2cycle_cycle0(struct rdp_state* rdp, uint32_t cu
 
     if (wen)
     {
-        rdp->inv_pixel_color.a =  (~(*rdp->blender1b_a[0])) & 0xff;
-
-        blender_equation_cycle0_2(rdp, &r, &g, &b);
+        blender_equation(rdp, 0, rdp->pastblshifta, rdp->pastblshiftb, 0, &r, &g, &b);
 
         rdp->blended_pixel_color.r = r;
         rdp->blended_pixel_color.g = g;
@@ -280,8 +231,7 @@ static STRICTINLINE void blender_2cycle_cycle1(struct rdp_state* rdp, uint32_t*
         }
         else
         {
-            rdp->inv_pixel_color.a =  (~(*rdp->blender1b_a[1])) & 0xff;
-            blender_equation_cycle1(rdp, &r, &g, &b);
+            blender_equation(rdp, 1, rdp->blshifta, rdp->blshiftb, !rdp->other_modes.force_blend, &r, &g, &b);
         }
     }
     else
@@ -299,6 +249,43 @@ static STRICTINLINE void blender_2cycle_cycle1(struct rdp_state* rdp, uint32_t*
     *fb = b;
 }
 
+static int blender_kernel(int m1b, int m2b)
+{
+    if (m2b == 0)
+        return BLENDER_KERNEL_INV_ALPHA;
+    if (m2b == 1)
+        return BLENDER_KERNEL_MEMORY;
+    if (m1b == 3 && m2b == 2)
+        return BLENDER_KERNEL_PASS;
+    return BLENDER_KERNEL_FULL;
+}
+
+static void blender_update(struct rdp_state* rdp)
+{
+    int special_bsel0, special_bsel1;
+
+    set_blender_input(rdp, 0, 0, &rdp->blender1a_r[0], &rdp->blender1a_g[0], &rdp->blender1a_b[0], &rdp->blender1b_a[0],
+                      rdp->other_modes.blend_m1a_0, rdp->other_modes.blend_m1b_0);
+    set_blender_input(rdp, 0, 1, &rdp->blender2a_r[0], &rdp->blender2a_g[0], &rdp->blender2a_b[0], &rdp->blender2b_a[0],
+                      rdp->other_modes.blend_m2a_0, rdp->other_modes.blend_m2b_0);
+    set_blender_input(rdp, 1, 0, &rdp->blender1a_r[1], &rdp->blender1a_g[1], &rdp->blender1a_b[1], &rdp->blender1b_a[1],
+                      rdp->other_modes.blend_m1a_1, rdp->other_modes.blend_m1b_1);
+    set_blender_input(rdp, 1, 1, &rdp->blender2a_r[1], &rdp->blender2a_g[1], &rdp->blender2a_b[1], &rdp->blender2b_a[1],
+                      rdp->other_modes.blend_m2a_1, rdp->other_modes.blend_m2b_1);
+
+    rdp->blender_kernel[0] = blender_kernel(rdp->other_modes.blend_m1b_0, rdp->other_modes.blend_m2b_0);
+    rdp->blender_kernel[1] = blender_kernel(rdp->other_modes.blend_m1b_1, rdp->other_modes.blend_m2b_1);
+
+    rdp->other_modes.f.partialreject_1cycle = (rdp->other_modes.blend_m2b_0 == 0 && rdp->other_modes.blend_m1b_0 == 0);
+    rdp->other_modes.f.partialreject_2cycle = (rdp->other_modes.blend_m2b_1 == 0 && rdp->other_modes.blend_m1b_1 == 0);
+
+    special_bsel0 = (rdp->blender_kernel[0] == BLENDER_KERNEL_MEMORY);
+    special_bsel1 = (rdp->blender_kernel[1] == BLENDER_KERNEL_MEMORY);
+
+    rdp->other_modes.f.realblendershiftersneeded = (special_bsel0 && rdp->other_modes.cycle_type == CYCLE_TYPE_1) || (special_bsel1 && rdp->other_modes.cycle_type == CYCLE_TYPE_2);
+    rdp->other_modes.f.interpixelblendershiftersneeded = (special_bsel0 && rdp->other_modes.cycle_type == CYCLE_TYPE_2);
+}
+
 static void blender_init_lut(void)
 {
     int i, k;
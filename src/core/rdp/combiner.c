@@ -137,6 +137,119 @@ static STRICTINLINE int32_t alpha_combiner_equation(int32_t a, int32_t b, int32_
     return (a & 0x1ff);
 }
 
+// computes the combined color and alpha of a cycle with the kernels that
+// were selected for the current combine mode
+static STRICTINLINE void combiner_equations(struct rdp_state* rdp, int cycle)
+{
+    switch (rdp->combiner_rgb_kernel[cycle])
+    {
+        case COMBINER_KERNEL_CONST:
+            rdp->combined_color.r = rdp->combiner_const[cycle].r;
+            rdp->combined_color.g = rdp->combiner_const[cycle].g;
+            rdp->combined_color.b = rdp->combiner_const[cycle].b;
+            break;
+        case COMBINER_KERNEL_ADD:
+            rdp->combined_color.r = ((special_9bit_exttable[*rdp->combiner_rgbadd_r[cycle]] << 8) + 0x80) & 0x1ffff;
+            rdp->combined_color.g = ((special_9bit_exttable[*rdp->combiner_rgbadd_g[cycle]] << 8) + 0x80) & 0x1ffff;
+            rdp->combined_color.b = ((special_9bit_exttable[*rdp->combiner_rgbadd_b[cycle]] << 8) + 0x80) & 0x1ffff;
+            break;
+        default:
+            rdp->combined_color.r = color_combiner_equation(*rdp->combiner_rgbsub_a_r[cycle],*rdp->combiner_rgbsub_b_r[cycle],*rdp->combiner_rgbmul_r[cycle],*rdp->combiner_rgbadd_r[cycle]);
+            rdp->combined_color.g = color_combiner_equation(*rdp->combiner_rgbsub_a_g[cycle],*rdp->combiner_rgbsub_b_g[cycle],*rdp->combiner_rgbmul_g[cycle],*rdp->combiner_rgbadd_g[cycle]);
+            rdp->combined_color.b = color_combiner_equation(*rdp->combiner_rgbsub_a_b[cycle],*rdp->combiner_rgbsub_b_b[cycle],*rdp->combiner_rgbmul_b[cycle],*rdp->combiner_rgbadd_b[cycle]);
+            break;
+    }
+
+    switch (rdp->combiner_alpha_kernel[cycle])
+    {
+        case COMBINER_KERNEL_CONST:
+            rdp->combined_color.a = rdp->combiner_const[cycle].a;
+            break;
+        case COMBINER_KERNEL_ADD:
+            rdp->combined_color.a = special_9bit_exttable[*rdp->combiner_alphaadd[cycle]] & 0x1ff;
+            break;
+        default:
+            rdp->combined_color.a = alpha_combiner_equation(*rdp->combiner_alphasub_a[cycle],*rdp->combiner_alphasub_b[cycle],*rdp->combiner_alphamul[cycle],*rdp->combiner_alphaadd[cycle]);
+            break;
+    }
+}
+
+// masks of the input codes of each combiner input that select values which
+// stay the same for all pixels of a primitive, like the primitive and
+// environment colors and the constants
+#define COMBINER_CONST_SUB_A_RGB    0xff68
+#define COMBINER_CONST_SUB_B_RGB    0xffe8
+#define COMBINER_CONST_MUL_RGB      0xffffd468
+#define COMBINER_CONST_ADD_RGB      0xe8
+#define COMBINER_CONST_ALPHA        0xe8
+
+#define COMBINER_CONST(mask, code)  (((mask) >> (code)) & 1)
+
+static INLINE int combiner_select_kernel(int mul_zero, int add_const, int all_const)
+{
+    if (mul_zero)
+        return add_const ? COMBINER_KERNEL_CONST : COMBINER_KERNEL_ADD;
+    else
+        return all_const ? COMBINER_KERNEL_CONST : COMBINER_KERNEL_FULL;
+}
+
+// selects the kernels of both cycles for the current combine mode and
+// computes the results of equations that only have constant inputs, which
+// must be repeated whenever one of the constant inputs changes
+static void combiner_update(struct rdp_state* rdp)
+{
+    int sub_a_rgb[2] = { rdp->combine.sub_a_rgb0, rdp->combine.sub_a_rgb1 };
+    int sub_b_rgb[2] = { rdp->combine.sub_b_rgb0, rdp->combine.sub_b_rgb1 };
+    int mul_rgb[2] = { rdp->combine.mul_rgb0, rdp->combine.mul_rgb1 };
+    int add_rgb[2] = { rdp->combine.add_rgb0, rdp->combine.add_rgb1 };
+    int sub_a_a[2] = { rdp->combine.sub_a_a0, rdp->combine.sub_a_a1 };
+    int sub_b_a[2] = { rdp->combine.sub_b_a0, rdp->combine.sub_b_a1 };
+    int mul_a[2] = { rdp->combine.mul_a0, rdp->combine.mul_a1 };
+    int add_a[2] = { rdp->combine.add_a0, rdp->combine.add_a1 };
+
+    int cycle;
+    for (cycle = 0; cycle < 2; cycle++)
+    {
+        int add_const = COMBINER_CONST(COMBINER_CONST_ADD_RGB, add_rgb[cycle]);
+        int all_const = add_const &&
+            COMBINER_CONST(COMBINER_CONST_SUB_A_RGB, sub_a_rgb[cycle]) &&
+            COMBINER_CONST(COMBINER_CONST_SUB_B_RGB, sub_b_rgb[cycle]) &&
+            COMBINER_CONST(COMBINER_CONST_MUL_RGB, mul_rgb[cycle]);
+        rdp->combiner_rgb_kernel[cycle] = combiner_select_kernel(rdp->combiner_rgbmul_r[cycle] == &zero_color, add_const, all_const);
+
+        add_const = COMBINER_CONST(COMBINER_CONST_ALPHA, add_a[cycle]);
+        all_const = add_const &&
+            COMBINER_CONST(COMBINER_CONST_ALPHA, sub_a_a[cycle]) &&
+            COMBINER_CONST(COMBINER_CONST_ALPHA, sub_b_a[cycle]) &&
+            COMBINER_CONST(COMBINER_CONST_ALPHA, mul_a[cycle]);
+        rdp->combiner_alpha_kernel[cycle] = combiner_select_kernel(rdp->combiner_alphamul[cycle] == &zero_color, add_const, all_const);
+
+        if (rdp->combiner_rgb_kernel[cycle] == COMBINER_KERNEL_CONST)
+        {
+            if (rdp->combiner_rgbmul_r[cycle] == &zero_color)
+            {
+                rdp->combiner_const[cycle].r = ((special_9bit_exttable[*rdp->combiner_rgbadd_r[cycle]] << 8) + 0x80) & 0x1ffff;
+                rdp->combiner_const[cycle].g = ((special_9bit_exttable[*rdp->combiner_rgbadd_g[cycle]] << 8) + 0x80) & 0x1ffff;
+                rdp->combiner_const[cycle].b = ((special_9bit_exttable[*rdp->combiner_rgbadd_b[cycle]] << 8) + 0x80) & 0x1ffff;
+            }
+            else
+            {
+                rdp->combiner_const[cycle].r = color_combiner_equation(*rdp->combiner_rgbsub_a_r[cycle],*rdp->combiner_rgbsub_b_r[cycle],*rdp->combiner_rgbmul_r[cycle],*rdp->combiner_rgbadd_r[cycle]);
+                rdp->combiner_const[cycle].g = color_combiner_equation(*rdp->combiner_rgbsub_a_g[cycle],*rdp->combiner_rgbsub_b_g[cycle],*rdp->combiner_rgbmul_g[cycle],*rdp->combiner_rgbadd_g[cycle]);
+                rdp->combiner_const[cycle].b = color_combiner_equation(*rdp->combiner_rgbsub_a_b[cycle],*rdp->combiner_rgbsub_b_b[cycle],*rdp->combiner_rgbmul_b[cycle],*rdp->combiner_rgbadd_b[cycle]);
+            }
+        }
+
+        if (rdp->combiner_alpha_kernel[cycle] == COMBINER_KERNEL_CONST)
+        {
+            if (rdp->combiner_alphamul[cycle] == &zero_color)
+                rdp->combiner_const[cycle].a = special_9bit_exttable[*rdp->combiner_alphaadd[cycle]] & 0x1ff;
+            else
+                rdp->combiner_const[cycle].a = alpha_combiner_equation(*rdp->combiner_alphasub_a[cycle],*rdp->combiner_alphasub_b[cycle],*rdp->combiner_alphamul[cycle],*rdp->combiner_alphaadd[cycle]);
+        }
+    }
+}
+
 static STRICTINLINE int32_t chroma_key_min(struct rdp_state* rdp, struct color* col)
 {
     int32_t redkey, greenkey, bluekey, keyalpha;
@@ -186,39 +299,7 @@ static STRICTINLINE void combiner_1cycle(struct rdp_state* rdp, int adseed, uint
 
 
 
-    if (rdp->combiner_rgbmul_r[1] != &zero_color)
-    {
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-        rdp->combined_color.r = color_combiner_equation(*rdp->combiner_rgbsub_a_r[1],*rdp->combiner_rgbsub_b_r[1],*rdp->combiner_rgbmul_r[1],*rdp->combiner_rgbadd_r[1]);
-        rdp->combined_color.g = color_combiner_equation(*rdp->combiner_rgbsub_a_g[1],*rdp->combiner_rgbsub_b_g[1],*rdp->combiner_rgbmul_g[1],*rdp->combiner_rgbadd_g[1]);
-        rdp->combined_color.b = color_combiner_equation(*rdp->combiner_rgbsub_a_b[1],*rdp->combiner_rgbsub_b_b[1],*rdp->combiner_rgbmul_b[1],*rdp->combiner_rgbadd_b[1]);
-    }
-    else
-    {
-        rdp->combined_color.r = ((special_9bit_exttable[*rdp->combiner_rgbadd_r[1]] << 8) + 0x80) & 0x1ffff;
-        rdp->combined_color.g = ((special_9bit_exttable[*rdp->combiner_rgbadd_g[1]] << 8) + 0x80) & 0x1ffff;
-        rdp->combined_color.b = ((special_9bit_exttable[*rdp->combiner_rgbadd_b[1]] << 8) + 0x80) & 0x1ffff;
-    }
-
-    if (rdp->combiner_alphamul[1] != &zero_color)
-        rdp->combined_color.a = alpha_combiner_equation(*rdp->combiner_alphasub_a[1],*rdp->combiner_alphasub_b[1],*rdp->combiner_alphamul[1],*rdp->combiner_alphaadd[1]);
-    else
-        rdp->combined_color.a = special_9bit_exttable[*rdp->combiner_alphaadd[1]] & 0x1ff;
+    combiner_equations(rdp, 1);
 
     rdp->pixel_color.a = special_9bit_clamptable[rdp->combined_color.a];
     if (rdp->pixel_color.a == 0xff)
@@ -285,23 +366,7 @@ static STRICTINLINE void combiner_1cycle(struct rdp_state* rdp, int adseed, uint
 
 static STRICTINLINE void combiner_2cycle_cycle0(struct rdp_state* rdp, int adseed, uint32_t cvg, uint32_t* acalpha)
 {
-    if (rdp->combiner_rgbmul_r[0] != &zero_color)
-    {
-        rdp->combined_color.r = color_combiner_equation(*rdp->combiner_rgbsub_a_r[0],*rdp->combiner_rgbsub_b_r[0],*rdp->combiner_rgbmul_r[0],*rdp->combiner_rgbadd_r[0]);
-        rdp->combined_color.g = color_combiner_equation(*rdp->combiner_rgbsub_a_g[0],*rdp->combiner_rgbsub_b_g[0],*rdp->combiner_rgbmul_g[0],*rdp->combiner_rgbadd_g[0]);
-        rdp->combined_color.b = color_combiner_equation(*rdp->combiner_rgbsub_a_b[0],*rdp->combiner_rgbsub_b_b[0],*rdp->combiner_rgbmul_b[0],*rdp->combiner_rgbadd_b[0]);
-    }
-    else
-    {
-        rdp->combined_color.r = ((special_9bit_exttable[*rdp->combiner_rgbadd_r[0]] << 8) + 0x80) & 0x1ffff;
-        rdp->combined_color.g = ((special_9bit_exttable[*rdp->combiner_rgbadd_g[0]] << 8) + 0x80) & 0x1ffff;
-        rdp->combined_color.b = ((special_9bit_exttable[*rdp->combiner_rgbadd_b[0]] << 8) + 0x80) & 0x1ffff;
-    }
-
-    if (rdp->combiner_alphamul[0] != &zero_color)
-        rdp->combined_color.a = alpha_combiner_equation(*rdp->combiner_alphasub_a[0],*rdp->combiner_alphasub_b[0],*rdp->combiner_alphamul[0],*rdp->combiner_alphaadd[0]);
-    else
-        rdp->combined_color.a = special_9bit_exttable[*rdp->combiner_alphaadd[0]] & 0x1ff;
+    combiner_equations(rdp, 0);
 
 
 
@@ -367,23 +432,7 @@ static STRICTINLINE void combiner_2cycle_cycle1(struct rdp_state* rdp, int adsee
         chromabypass.b = *rdp->combiner_rgbsub_a_b[1];
     }
 
-    if (rdp->combiner_rgbmul_r[1] != &zero_color)
-    {
-        rdp->combined_color.r = color_combiner_equation(*rdp->combiner_rgbsub_a_r[1],*rdp->combiner_rgbsub_b_r[1],*rdp->combiner_rgbmul_r[1],*rdp->combiner_rgbadd_r[1]);
-        rdp->combined_color.g = color_combiner_equation(*rdp->combiner_rgbsub_a_g[1],*rdp->combiner_rgbsub_b_g[1],*rdp->combiner_rgbmul_g[1],*rdp->combiner_rgbadd_g[1]);
-        rdp->combined_color.b = color_combiner_equation(*rdp->combiner_rgbsub_a_b[1],*rdp->combiner_rgbsub_b_b[1],*rdp->combiner_rgbmul_b[1],*rdp->combiner_rgbadd_b[1]);
-    }
-    else
-    {
-        rdp->combined_color.r = ((special_9bit_exttable[*rdp->combiner_rgbadd_r[1]] << 8) + 0x80) & 0x1ffff;
-        rdp->combined_color.g = ((special_9bit_exttable[*rdp->combiner_rgbadd_g[1]] << 8) + 0x80) & 0x1ffff;
-        rdp->combined_color.b = ((special_9bit_exttable[*rdp->combiner_rgbadd_b[1]] << 8) + 0x80) & 0x1ffff;
-    }
-
-    if (rdp->combiner_alphamul[1] != &zero_color)
-        rdp->combined_color.a = alpha_combiner_equation(*rdp->combiner_alphasub_a[1],*rdp->combiner_alphasub_b[1],*rdp->combiner_alphamul[1],*rdp->combiner_alphaadd[1]);
-    else
-        rdp->combined_color.a = special_9bit_exttable[*rdp->combiner_alphaadd[1]] & 0x1ff;
+    combiner_equations(rdp, 1);
 
     if (!rdp->other_modes.key_en)
     {
@@ -497,6 +546,8 @@ static void combiner_init(struct rdp_state* rdp)
     rdp->combiner_alphasub_b[0] = rdp->combiner_alphasub_b[1] = &one_color;
     rdp->combiner_alphamul[0] = rdp->combiner_alphamul[1] = &one_color;
     rdp->combiner_alphaadd[0] = rdp->combiner_alphaadd[1] = &one_color;
+
+    combiner_update(rdp);
 }
 
 void rdp_set_prim_color(struct rdp_state* rdp, const uint32_t* args)
@@ -507,6 +558,8 @@ void rdp_set_prim_color(struct rdp_state* rdp, const uint32_t* args)
     rdp->prim_color.g = RGBA32_G(args[1]);
     rdp->prim_color.b = RGBA32_B(args[1]);
     rdp->prim_color.a = RGBA32_A(args[1]);
+
+    combiner_update(rdp);
 }
 
 void rdp_set_env_color(struct rdp_state* rdp, const uint32_t* args)
@@ -515,6 +568,8 @@ void rdp_set_env_color(struct rdp_state* rdp, const uint32_t* args)
     rdp->env_color.g = RGBA32_G(args[1]);
     rdp->env_color.b = RGBA32_B(args[1]);
     rdp->env_color.a = RGBA32_A(args[1]);
+
+    combiner_update(rdp);
 }
 
 void rdp_set_combine(struct rdp_state* rdp, const uint32_t* args)
@@ -556,6 +611,8 @@ void rdp_set_combine(struct rdp_state* rdp, const uint32_t* args)
     set_mul_alpha_input(rdp, &rdp->combiner_alphamul[1], rdp->combine.mul_a1);
     set_sub_alpha_input(rdp, &rdp->combiner_alphaadd[1], rdp->combine.add_a1);
 
+    combiner_update(rdp);
+
     rdp->other_modes.f.stalederivs = 1;
 }
 
@@ -567,6 +624,8 @@ void rdp_set_key_gb(struct rdp_state* rdp, const uint32_t* args)
     rdp->key_scale.g = (args[1] >> 16) & 0xff;
     rdp->key_center.b = (args[1] >> 8) & 0xff;
     rdp->key_scale.b = args[1] & 0xff;
+
+    combiner_update(rdp);
 }
 
 void rdp_set_key_r(struct rdp_state* rdp, const uint32_t* args)
@@ -574,4 +633,6 @@ void rdp_set_key_r(struct rdp_state* rdp, const uint32_t* args)
     rdp->key_width.r = (args[1] >> 16) & 0xfff;
     rdp->key_center.r = (args[1] >> 8) & 0xff;
     rdp->key_scale.r = args[1] & 0xff;
+
+    combiner_update(rdp);
 }
@@ -1,31 +1,3 @@
-static void fbwrite_4(struct rdp_state* rdp, uint32_t curpixel, uint32_t r, uint32_t g, uint32_t b, uint32_t blend_en, uint32_t curpixel_cvg, uint32_t curpixel_memcvg);
-static void fbwrite_8(struct rdp_state* rdp, uint32_t curpixel, uint32_t r, uint32_t g, uint32_t b, uint32_t blend_en, uint32_t curpixel_cvg, uint32_t curpixel_memcvg);
-static void fbwrite_16(struct rdp_state* rdp, uint32_t curpixel, uint32_t r, uint32_t g, uint32_t b, uint32_t blend_en, uint32_t curpixel_cvg, uint32_t curpixel_memcvg);
-static void fbwrite_32(struct rdp_state* rdp, uint32_t curpixel, uint32_t r, uint32_t g, uint32_t b, uint32_t blend_en, uint32_t curpixel_cvg, uint32_t curpixel_memcvg);
-static void fbread_4(struct rdp_state* rdp, uint32_t num, uint32_t* curpixel_memcvg);
-static void fbread_8(struct rdp_state* rdp, uint32_t num, uint32_t* curpixel_memcvg);
-static void fbread_16(struct rdp_state* rdp, uint32_t num, uint32_t* curpixel_memcvg);
-static void fbread_32(struct rdp_state* rdp, uint32_t num, uint32_t* curpixel_memcvg);
-static void fbread2_4(struct rdp_state* rdp, uint32_t num, uint32_t* curpixel_memcvg);
-static void fbread2_8(struct rdp_state* rdp, uint32_t num, uint32_t* curpixel_memcvg);
-static void fbread2_16(struct rdp_state* rdp, uint32_t num, uint32_t* curpixel_memcvg);
-static void fbread2_32(struct rdp_state* rdp, uint32_t num, uint32_t* curpixel_memcvg);
-
-static void (*fbread_func[4])(struct rdp_state*,uint32_t, uint32_t*) =
-{
-    fbread_4, fbread_8, fbread_16, fbread_32
-};
-
-static void (*fbread2_func[4])(struct rdp_state*,uint32_t, uint32_t*) =
-{
-    fbread2_4, fbread2_8, fbread2_16, fbread2_32
-};
-
-static void (*fbwrite_func[4])(struct rdp_state*, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t) =
-{
-    fbwrite_4, fbwrite_8, fbwrite_16, fbwrite_32
-};
-
 static void fbwrite_4(struct rdp_state* rdp, uint32_t curpixel, uint32_t r, uint32_t g, uint32_t b, uint32_t blend_en, uint32_t curpixel_cvg, uint32_t curpixel_memcvg)
 {
     uint32_t fb = rdp->fb_address + curpixel;
@@ -38,7 +10,7 @@ static void fbwrite_8(struct rdp_state* rdp, uint32_t curpixel, uint32_t r, uint
     PAIRWRITE8(fb, r & 0xff, (r & 1) ? 3 : 0);
 }
 
-static void fbwrite_16(struct rdp_state* rdp, uint32_t curpixel, uint32_t r, uint32_t g, uint32_t b, uint32_t blend_en, uint32_t curpixel_cvg, uint32_t curpixel_memcvg)
+static STRICTINLINE void fbwrite_16(struct rdp_state* rdp, uint32_t curpixel, uint32_t r, uint32_t g, uint32_t b, uint32_t blend_en, uint32_t curpixel_cvg, uint32_t curpixel_memcvg, int inrdram)
 {
 #undef CVG_DRAW
 #ifdef CVG_DRAW
@@ -67,10 +39,13 @@ static void fbwrite_16(struct rdp_state* rdp, uint32_t curpixel, uint32_t r, uin
 
     rval = finalcolor|(finalcvg >> 2);
     hval = finalcvg & 3;
-    PAIRWRITE16(fb, rval, hval);
+    if (inrdram)
+        rdram_write_pair16_fast(fb, rval, hval);
+    else
+        PAIRWRITE16(fb, rval, hval);
 }
 
-static void fbwrite_32(struct rdp_state* rdp, uint32_t curpixel, uint32_t r, uint32_t g, uint32_t b, uint32_t blend_en, uint32_t curpixel_cvg, uint32_t curpixel_memcvg)
+static STRICTINLINE void fbwrite_32(struct rdp_state* rdp, uint32_t curpixel, uint32_t r, uint32_t g, uint32_t b, uint32_t blend_en, uint32_t curpixel_cvg, uint32_t curpixel_memcvg, int inrdram)
 {
     uint32_t fb = (rdp->fb_address >> 2) + curpixel;
 
@@ -80,7 +55,10 @@ static void fbwrite_32(struct rdp_state* rdp, uint32_t curpixel, uint32_t r, uin
     finalcolor = (r << 24) | (g << 16) | (b << 8);
     finalcolor |= (finalcvg << 5);
 
-    PAIRWRITE32(fb, finalcolor, (g & 1) ? 3 : 0, 0);
+    if (inrdram)
+        rdram_write_pair32_fast(fb, finalcolor, (g & 1) ? 3 : 0, 0);
+    else
+        PAIRWRITE32(fb, finalcolor, (g & 1) ? 3 : 0, 0);
 }
 
 static void fbfill_4(struct rdp_state* rdp, uint32_t curpixel)
@@ -115,6 +93,50 @@ static void fbfill_32(struct rdp_state* rdp, uint32_t curpixel)
     PAIRWRITE32(fb, rdp->fill_color, (rdp->fill_color & 0x10000) ? 3 : 0, (rdp->fill_color & 0x1) ? 3 : 0);
 }
 
+// fill length pixels starting at curpixel, which are written as whole words
+// if they are all inside RDRAM
+static void fbfill_span_16(struct rdp_state* rdp, uint32_t curpixel, uint32_t length)
+{
+    uint32_t fb = ((rdp->fb_address >> 1) + curpixel) & (RDRAM_MASK >> 1);
+    uint32_t i;
+
+    if (!rdram_valid_range16(fb, length))
+    {
+        for (i = 0; i < length; i++)
+            fbfill_16(rdp, curpixel + i);
+        return;
+    }
+
+    // both halves of a word are filled with the fill color as is
+    if (fb & 1)
+    {
+        fbfill_16(rdp, curpixel);
+        fb++;
+        curpixel++;
+        length--;
+    }
+
+    rdram_fill_pair32(fb >> 1, length >> 1, rdp->fill_color, (rdp->fill_color & 0x10000) ? 3 : 0, (rdp->fill_color & 0x1) ? 3 : 0);
+
+    if (length & 1)
+        fbfill_16(rdp, curpixel + length - 1);
+}
+
+static void fbfill_span_32(struct rdp_state* rdp, uint32_t curpixel, uint32_t length)
+{
+    uint32_t fb = ((rdp->fb_address >> 2) + curpixel) & (RDRAM_MASK >> 2);
+    uint32_t i;
+
+    if (!rdram_valid_range32(fb, length))
+    {
+        for (i = 0; i < length; i++)
+            fbfill_32(rdp, curpixel + i);
+        return;
+    }
+
+    rdram_fill_pair32(fb, length, rdp->fill_color, (rdp->fill_color & 0x10000) ? 3 : 0, (rdp->fill_color & 0x1) ? 3 : 0);
+}
+
 static void fbread_4(struct rdp_state* rdp, uint32_t curpixel, uint32_t* curpixel_memcvg)
 {
     rdp->memory_color.r = rdp->memory_color.g = rdp->memory_color.b = 0;
@@ -150,7 +172,7 @@ static void fbread2_8(struct rdp_state* rdp, uint32_t curpixel, uint32_t* curpix
     *curpixel_memcvg = 7;
 }
 
-static void fbread_16(struct rdp_state* rdp, uint32_t curpixel, uint32_t* curpixel_memcvg)
+static STRICTINLINE void fbread_16(struct rdp_state* rdp, uint32_t curpixel, uint32_t* curpixel_memcvg, int inrdram)
 {
     uint16_t fword;
     uint8_t hbyte;
@@ -161,7 +183,10 @@ static void fbread_16(struct rdp_state* rdp, uint32_t curpixel, uint32_t* curpix
 
     if (rdp->other_modes.image_read_en)
     {
-        PAIRREAD16(fword, hbyte, addr);
+        if (inrdram)
+            rdram_read_pair16_fast(&fword, &hbyte, addr);
+        else
+            PAIRREAD16(fword, hbyte, addr);
 
         if (rdp->fb_format == FORMAT_RGBA)
         {
@@ -181,7 +206,10 @@ static void fbread_16(struct rdp_state* rdp, uint32_t curpixel, uint32_t* curpix
     }
     else
     {
-        RREADIDX16(fword, addr);
+        if (inrdram)
+            fword = rdram_read_idx16_fast(addr);
+        else
+            RREADIDX16(fword, addr);
 
         if (rdp->fb_format == FORMAT_RGBA)
         {
@@ -197,7 +225,7 @@ static void fbread_16(struct rdp_state* rdp, uint32_t curpixel, uint32_t* curpix
     }
 }
 
-static void fbread2_16(struct rdp_state* rdp, uint32_t curpixel, uint32_t* curpixel_memcvg)
+static STRICTINLINE void fbread2_16(struct rdp_state* rdp, uint32_t curpixel, uint32_t* curpixel_memcvg, int inrdram)
 {
     uint16_t fword;
     uint8_t hbyte;
@@ -207,7 +235,10 @@ static void fbread2_16(struct rdp_state* rdp, uint32_t curpixel, uint32_t* curpi
 
     if (rdp->other_modes.image_read_en)
     {
-        PAIRREAD16(fword, hbyte, addr);
+        if (inrdram)
+            rdram_read_pair16_fast(&fword, &hbyte, addr);
+        else
+            PAIRREAD16(fword, hbyte, addr);
 
         if (rdp->fb_format == FORMAT_RGBA)
         {
@@ -227,7 +258,10 @@ static void fbread2_16(struct rdp_state* rdp, uint32_t curpixel, uint32_t* curpi
     }
     else
     {
-        RREADIDX16(fword, addr);
+        if (inrdram)
+            fword = rdram_read_idx16_fast(addr);
+        else
+            RREADIDX16(fword, addr);
 
         if (rdp->fb_format == FORMAT_RGBA)
         {
@@ -244,10 +278,13 @@ static void fbread2_16(struct rdp_state* rdp, uint32_t curpixel, uint32_t* curpi
 
 }
 
-static void fbread_32(struct rdp_state* rdp, uint32_t curpixel, uint32_t* curpixel_memcvg)
+static STRICTINLINE void fbread_32(struct rdp_state* rdp, uint32_t curpixel, uint32_t* curpixel_memcvg, int inrdram)
 {
     uint32_t mem, addr = (rdp->fb_address >> 2) + curpixel;
-    RREADIDX32(mem, addr);
+    if (inrdram)
+        mem = rdram_read_idx32_fast(addr);
+    else
+        RREADIDX32(mem, addr);
     rdp->memory_color.r = RGBA32_R(mem);
     rdp->memory_color.g = RGBA32_G(mem);
     rdp->memory_color.b = RGBA32_B(mem);
@@ -263,10 +300,13 @@ static void fbread_32(struct rdp_state* rdp, uint32_t curpixel, uint32_t* curpix
     }
 }
 
-static INLINE void fbread2_32(struct rdp_state* rdp, uint32_t curpixel, uint32_t* curpixel_memcvg)
+static STRICTINLINE void fbread2_32(struct rdp_state* rdp, uint32_t curpixel, uint32_t* curpixel_memcvg, int inrdram)
 {
     uint32_t mem, addr = (rdp->fb_address >> 2) + curpixel;
-    RREADIDX32(mem, addr);
+    if (inrdram)
+        mem = rdram_read_idx32_fast(addr);
+    else
+        RREADIDX32(mem, addr);
     rdp->pre_memory_color.r = RGBA32_R(mem);
     rdp->pre_memory_color.g = RGBA32_G(mem);
     rdp->pre_memory_color.b = RGBA32_B(mem);
@@ -282,6 +322,59 @@ static INLINE void fbread2_32(struct rdp_state* rdp, uint32_t curpixel, uint32_t
     }
 }
 
+// color image accesses of the span renderers, which pass the pixel size as a
+// constant for the most common sizes, inrdram is set by span_in_rdram if all
+// pixels of the span are inside RDRAM and enables the unchecked accesses for
+// 16 and 32 bit pixels
+static STRICTINLINE void fbread1(struct rdp_state* rdp, int fb_size, uint32_t curpixel, uint32_t* curpixel_memcvg, int inrdram)
+{
+    switch (fb_size) {
+        case PIXEL_SIZE_4BIT: fbread_4(rdp, curpixel, curpixel_memcvg); break;
+        case PIXEL_SIZE_8BIT: fbread_8(rdp, curpixel, curpixel_memcvg); break;
+        case PIXEL_SIZE_16BIT: fbread_16(rdp, curpixel, curpixel_memcvg, inrdram); break;
+        default: fbread_32(rdp, curpixel, curpixel_memcvg, inrdram); break;
+    }
+}
+
+static STRICTINLINE void fbread2(struct rdp_state* rdp, int fb_size, uint32_t curpixel, uint32_t* curpixel_memcvg, int inrdram)
+{
+    switch (fb_size) {
+        case PIXEL_SIZE_4BIT: fbread2_4(rdp, curpixel, curpixel_memcvg); break;
+        case PIXEL_SIZE_8BIT: fbread2_8(rdp, curpixel, curpixel_memcvg); break;
+        case PIXEL_SIZE_16BIT: fbread2_16(rdp, curpixel, curpixel_memcvg, inrdram); break;
+        default: fbread2_32(rdp, curpixel, curpixel_memcvg, inrdram); break;
+    }
+}
+
+static STRICTINLINE void fbwrite(struct rdp_state* rdp, int fb_size, uint32_t curpixel, uint32_t r, uint32_t g, uint32_t b, uint32_t blend_en, uint32_t curpixel_cvg, uint32_t curpixel_memcvg, int inrdram)
+{
+    switch (fb_size) {
+        case PIXEL_SIZE_4BIT: fbwrite_4(rdp, curpixel, r, g, b, blend_en, curpixel_cvg, curpixel_memcvg); break;
+        case PIXEL_SIZE_8BIT: fbwrite_8(rdp, curpixel, r, g, b, blend_en, curpixel_cvg, curpixel_memcvg); break;
+        case PIXEL_SIZE_16BIT: fbwrite_16(rdp, curpixel, r, g, b, blend_en, curpixel_cvg, curpixel_memcvg, inrdram); break;
+        default: fbwrite_32(rdp, curpixel, r, g, b, blend_en, curpixel_cvg, curpixel_memcvg, inrdram); break;
+    }
+}
+
+// checks if the color image and, if used, the Z buffer pixels of a span of
+// length + 1 pixels ending at curpixel are all inside RDRAM
+static STRICTINLINE int span_in_rdram(struct rdp_state* rdp, int fb_size, int z_en, uint32_t curpixel, int length, int flip)
+{
+    uint32_t left = flip ? curpixel : curpixel - length;
+    int inrdram;
+
+    switch (fb_size) {
+        case PIXEL_SIZE_16BIT: inrdram = rdram_valid_range16((rdp->fb_address >> 1) + left, length + 1); break;
+        case PIXEL_SIZE_32BIT: inrdram = rdram_valid_range32((rdp->fb_address >> 2) + left, length + 1); break;
+        default: inrdram = 0; break;
+    }
+
+    if (z_en)
+        inrdram = inrdram && rdram_valid_range16((rdp->zb_address >> 1) + left, length + 1);
+
+    return inrdram;
+}
+
 void rdp_set_color_image(struct rdp_state* rdp, const uint32_t* args)
 {
     rdp->fb_format   = (args[0] >> 21) & 0x7;
@@ -290,9 +383,8 @@ void rdp_set_color_image(struct rdp_state* rdp, const uint32_t* args)
     rdp->fb_address  = args[1] & 0x0ffffff;
 
 
-    rdp->fbread1_ptr = fbread_func[rdp->fb_size];
-    rdp->fbread2_ptr = fbread2_func[rdp->fb_size];
-    rdp->fbwrite_ptr = fbwrite_func[rdp->fb_size];
+    // the span renderers are specialized on the pixel size
+    rdp->other_modes.f.stalederivs = 1;
 }
 
 void rdp_set_fill_color(struct rdp_state* rdp, const uint32_t* args)
@@ -306,9 +398,4 @@ static void fb_init(struct rdp_state* rdp)
     rdp->fb_size = PIXEL_SIZE_4BIT;
     rdp->fb_width = 0;
     rdp->fb_address = 0;
-
-
-    rdp->fbread1_ptr = fbread_func[rdp->fb_size];
-    rdp->fbread2_ptr = fbread2_func[rdp->fb_size];
-    rdp->fbwrite_ptr = fbwrite_func[rdp->fb_size];
 }
@@ -184,10 +184,235 @@ static STRICTINLINE void z_correct(struct rdp_state* rdp, int offx, int offy, in
     }
 }
 
-static void render_spans_1cycle_complete(struct rdp_state* rdp, int start, int end, int tilenum, int flip)
+// shade_span prepares the shade color, Z value and coverage of count pixels of
+// a span starting at x, as well as of the pixel after them with no coverage,
+// which is what the two cycle renderers evaluate ahead of the last pixel,
+// none of this depends on the results of previous pixels, so the SIMD
+// versions handle four pixels at a time
+#if defined(SIMD_SSE2)
+static STRICTINLINE __m128i shade_lanes(int v, int inc)
+{
+    uint32_t uv = v, uinc = inc;
+    return _mm_set_epi32(uv + 3 * uinc, uv + 2 * uinc, uv + uinc, uv);
+}
+
+static STRICTINLINE __m128i shade_select(__m128i mask, __m128i a, __m128i b)
+{
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+static STRICTINLINE __m128i shade_summand(__m128i bx1, __m128i bx2, __m128i by1, __m128i by2, int dx, int dy)
+{
+    // offx and offy are at most 3, so their products are sums of selected
+    // multiples of the derivatives
+    __m128i sx = _mm_add_epi32(_mm_and_si128(bx1, _mm_set1_epi32(dx)), _mm_and_si128(bx2, _mm_set1_epi32((uint32_t)dx << 1)));
+    __m128i sy = _mm_add_epi32(_mm_and_si128(by1, _mm_set1_epi32(dy)), _mm_and_si128(by2, _mm_set1_epi32((uint32_t)dy << 1)));
+    return _mm_add_epi32(sx, sy);
+}
+
+static STRICTINLINE __m128i shade_channel(__m128i v, __m128i full, __m128i summand)
+{
+    __m128i s = _mm_srai_epi32(v, 14);
+    __m128i c = shade_select(full, _mm_srai_epi32(s, 2), _mm_srai_epi32(_mm_add_epi32(_mm_slli_epi32(s, 2), summand), 4));
+
+    // same as special_9bit_clamptable
+    __m128i sel = _mm_and_si128(c, _mm_set1_epi32(0x180));
+    __m128i over = _mm_cmpeq_epi32(sel, _mm_set1_epi32(0x100));
+    __m128i under = _mm_cmpeq_epi32(sel, _mm_set1_epi32(0x180));
+    c = _mm_or_si128(_mm_and_si128(c, _mm_set1_epi32(0xff)), _mm_and_si128(over, _mm_set1_epi32(0xff)));
+    return _mm_andnot_si128(under, c);
+}
+
+static STRICTINLINE void shade_span(struct rdp_state* rdp, int x, int xinc, int count, int r, int g, int b, int a, int z,
+                                    int drinc, int dginc, int dbinc, int dainc, int dzinc)
+{
+    __m128i vr = shade_lanes(r, drinc);
+    __m128i vg = shade_lanes(g, dginc);
+    __m128i vb = shade_lanes(b, dbinc);
+    __m128i va = shade_lanes(a, dainc);
+    __m128i vz = shade_lanes(z, dzinc);
+    __m128i one = _mm_set1_epi32(1);
+    __m128i two = _mm_set1_epi32(2);
+    __m128i ff = _mm_set1_epi32(0xff);
+    uint32_t cv[4];
+    int i, k;
+
+    for (k = 0; k <= count; k += 4)
+    {
+        for (i = 0; i < 4; i++)
+        {
+            uint8_t mask = (k + i < count) ? rdp->cvgbuf[x] : 0;
+            memcpy(&cv[i], &cvarray[mask], sizeof(cv[i]));
+            rdp->span_cvg[k + i] = cvarray[mask].cvg;
+            rdp->span_cvbit[k + i] = cvarray[mask].cvbit;
+            x += xinc;
+        }
+
+        __m128i vcv = _mm_loadu_si128((const __m128i*)cv);
+        __m128i full = _mm_cmpeq_epi32(_mm_and_si128(vcv, ff), _mm_set1_epi32(8));
+        __m128i offx = _mm_and_si128(_mm_srli_epi32(vcv, 16), ff);
+        __m128i offy = _mm_srli_epi32(vcv, 24);
+        __m128i bx1 = _mm_cmpeq_epi32(_mm_and_si128(offx, one), one);
+        __m128i bx2 = _mm_cmpeq_epi32(_mm_and_si128(offx, two), two);
+        __m128i by1 = _mm_cmpeq_epi32(_mm_and_si128(offy, one), one);
+        __m128i by2 = _mm_cmpeq_epi32(_mm_and_si128(offy, two), two);
+
+        __m128i sr = shade_channel(vr, full, shade_summand(bx1, bx2, by1, by2, rdp->spans_cdr, rdp->spans_drdy));
+        __m128i sg = shade_channel(vg, full, shade_summand(bx1, bx2, by1, by2, rdp->spans_cdg, rdp->spans_dgdy));
+        __m128i sb = shade_channel(vb, full, shade_summand(bx1, bx2, by1, by2, rdp->spans_cdb, rdp->spans_dbdy));
+        __m128i sa = shade_channel(va, full, shade_summand(bx1, bx2, by1, by2, rdp->spans_cda, rdp->spans_dady));
+
+        // transpose to one color per pixel
+        __m128i rg_lo = _mm_unpacklo_epi32(sr, sg);
+        __m128i ba_lo = _mm_unpacklo_epi32(sb, sa);
+        __m128i rg_hi = _mm_unpackhi_epi32(sr, sg);
+        __m128i ba_hi = _mm_unpackhi_epi32(sb, sa);
+        _mm_storeu_si128((__m128i*)&rdp->span_shade[k + 0], _mm_unpacklo_epi64(rg_lo, ba_lo));
+        _mm_storeu_si128((__m128i*)&rdp->span_shade[k + 1], _mm_unpackhi_epi64(rg_lo, ba_lo));
+        _mm_storeu_si128((__m128i*)&rdp->span_shade[k + 2], _mm_unpacklo_epi64(rg_hi, ba_hi));
+        _mm_storeu_si128((__m128i*)&rdp->span_shade[k + 3], _mm_unpackhi_epi64(rg_hi, ba_hi));
+
+        // same as z_correct
+        __m128i sz = _mm_and_si128(_mm_srai_epi32(vz, 10), _mm_set1_epi32(0x3fffff));
+        __m128i summand_z = shade_summand(bx1, bx2, by1, by2, rdp->spans_cdz, rdp->spans_dzdy);
+        sz = shade_select(full, _mm_srai_epi32(sz, 3), _mm_srai_epi32(_mm_add_epi32(_mm_slli_epi32(sz, 2), summand_z), 5));
+        __m128i zanded = _mm_and_si128(sz, _mm_set1_epi32(0x60000));
+        __m128i zmax = _mm_set1_epi32(0x3ffff);
+        sz = _mm_or_si128(_mm_and_si128(sz, zmax), _mm_and_si128(_mm_cmpeq_epi32(zanded, _mm_set1_epi32(0x40000)), zmax));
+        sz = _mm_andnot_si128(_mm_cmpeq_epi32(zanded, _mm_set1_epi32(0x60000)), sz);
+        _mm_storeu_si128((__m128i*)&rdp->span_z[k], sz);
+
+        vr = _mm_add_epi32(vr, _mm_set1_epi32((uint32_t)drinc << 2));
+        vg = _mm_add_epi32(vg, _mm_set1_epi32((uint32_t)dginc << 2));
+        vb = _mm_add_epi32(vb, _mm_set1_epi32((uint32_t)dbinc << 2));
+        va = _mm_add_epi32(va, _mm_set1_epi32((uint32_t)dainc << 2));
+        vz = _mm_add_epi32(vz, _mm_set1_epi32((uint32_t)dzinc << 2));
+    }
+}
+#elif defined(SIMD_NEON)
+static STRICTINLINE int32x4_t shade_lanes(int v, int inc)
+{
+    uint32_t uv = v, uinc = inc;
+    int32_t lanes[4] = { uv, uv + uinc, uv + 2 * uinc, uv + 3 * uinc };
+    return vld1q_s32(lanes);
+}
+
+static STRICTINLINE int32x4_t shade_summand(uint32x4_t bx1, uint32x4_t bx2, uint32x4_t by1, uint32x4_t by2, int dx, int dy)
+{
+    // offx and offy are at most 3, so their products are sums of selected
+    // multiples of the derivatives
+    int32x4_t zero = vdupq_n_s32(0);
+    int32x4_t sx = vaddq_s32(vbslq_s32(bx1, vdupq_n_s32(dx), zero), vbslq_s32(bx2, vdupq_n_s32((uint32_t)dx << 1), zero));
+    int32x4_t sy = vaddq_s32(vbslq_s32(by1, vdupq_n_s32(dy), zero), vbslq_s32(by2, vdupq_n_s32((uint32_t)dy << 1), zero));
+    return vaddq_s32(sx, sy);
+}
+
+static STRICTINLINE int32x4_t shade_channel(int32x4_t v, uint32x4_t full, int32x4_t summand)
+{
+    int32x4_t s = vshrq_n_s32(v, 14);
+    int32x4_t c = vbslq_s32(full, vshrq_n_s32(s, 2), vshrq_n_s32(vaddq_s32(vshlq_n_s32(s, 2), summand), 4));
+
+    // same as special_9bit_clamptable
+    int32x4_t sel = vandq_s32(c, vdupq_n_s32(0x180));
+    uint32x4_t over = vceqq_s32(sel, vdupq_n_s32(0x100));
+    uint32x4_t under = vceqq_s32(sel, vdupq_n_s32(0x180));
+    c = vbslq_s32(over, vdupq_n_s32(0xff), vandq_s32(c, vdupq_n_s32(0xff)));
+    return vbslq_s32(under, vdupq_n_s32(0), c);
+}
+
+static STRICTINLINE void shade_span(struct rdp_state* rdp, int x, int xinc, int count, int r, int g, int b, int a, int z,
+                                    int drinc, int dginc, int dbinc, int dainc, int dzinc)
+{
+    int32x4_t vr = shade_lanes(r, drinc);
+    int32x4_t vg = shade_lanes(g, dginc);
+    int32x4_t vb = shade_lanes(b, dbinc);
+    int32x4_t va = shade_lanes(a, dainc);
+    int32x4_t vz = shade_lanes(z, dzinc);
+    uint32_t cv[4];
+    int i, k;
+
+    for (k = 0; k <= count; k += 4)
+    {
+        for (i = 0; i < 4; i++)
+        {
+            uint8_t mask = (k + i < count) ? rdp->cvgbuf[x] : 0;
+            memcpy(&cv[i], &cvarray[mask], sizeof(cv[i]));
+            rdp->span_cvg[k + i] = cvarray[mask].cvg;
+            rdp->span_cvbit[k + i] = cvarray[mask].cvbit;
+            x += xinc;
+        }
+
+        uint32x4_t vcv = vld1q_u32(cv);
+        uint32x4_t full = vceqq_u32(vandq_u32(vcv, vdupq_n_u32(0xff)), vdupq_n_u32(8));
+        uint32x4_t offx = vandq_u32(vshrq_n_u32(vcv, 16), vdupq_n_u32(0xff));
+        uint32x4_t offy = vshrq_n_u32(vcv, 24);
+        uint32x4_t bx1 = vtstq_u32(offx, vdupq_n_u32(1));
+        uint32x4_t bx2 = vtstq_u32(offx, vdupq_n_u32(2));
+        uint32x4_t by1 = vtstq_u32(offy, vdupq_n_u32(1));
+        uint32x4_t by2 = vtstq_u32(offy, vdupq_n_u32(2));
+
+        int32x4x4_t shade;
+        shade.val[0] = shade_channel(vr, full, shade_summand(bx1, bx2, by1, by2, rdp->spans_cdr, rdp->spans_drdy));
+        shade.val[1] = shade_channel(vg, full, shade_summand(bx1, bx2, by1, by2, rdp->spans_cdg, rdp->spans_dgdy));
+        shade.val[2] = shade_channel(vb, full, shade_summand(bx1, bx2, by1, by2, rdp->spans_cdb, rdp->spans_dbdy));
+        shade.val[3] = shade_channel(va, full, shade_summand(bx1, bx2, by1, by2, rdp->spans_cda, rdp->spans_dady));
+
+        // interleave to one color per pixel
+        vst4q_s32(&rdp->span_shade[k].r, shade);
+
+        // same as z_correct
+        int32x4_t sz = vandq_s32(vshrq_n_s32(vz, 10), vdupq_n_s32(0x3fffff));
+        int32x4_t summand_z = shade_summand(bx1, bx2, by1, by2, rdp->spans_cdz, rdp->spans_dzdy);
+        sz = vbslq_s32(full, vshrq_n_s32(sz, 3), vshrq_n_s32(vaddq_s32(vshlq_n_s32(sz, 2), summand_z), 5));
+        int32x4_t zanded = vandq_s32(sz, vdupq_n_s32(0x60000));
+        sz = vbslq_s32(vceqq_s32(zanded, vdupq_n_s32(0x40000)), vdupq_n_s32(0x3ffff), vandq_s32(sz, vdupq_n_s32(0x3ffff)));
+        sz = vbslq_s32(vceqq_s32(zanded, vdupq_n_s32(0x60000)), vdupq_n_s32(0), sz);
+        vst1q_s32(&rdp->span_z[k], sz);
+
+        vr = vaddq_s32(vr, vdupq_n_s32((uint32_t)drinc << 2));
+        vg = vaddq_s32(vg, vdupq_n_s32((uint32_t)dginc << 2));
+        vb = vaddq_s32(vb, vdupq_n_s32((uint32_t)dbinc << 2));
+        va = vaddq_s32(va, vdupq_n_s32((uint32_t)dainc << 2));
+        vz = vaddq_s32(vz, vdupq_n_s32((uint32_t)dzinc << 2));
+    }
+}
+#else
+static STRICTINLINE void shade_span(struct rdp_state* rdp, int x, int xinc, int count, int r, int g, int b, int a, int z,
+                                    int drinc, int dginc, int dbinc, int dainc, int dzinc)
+{
+    uint8_t offx, offy;
+    uint32_t cvg, cvbit;
+    int k, sz;
+
+    for (k = 0; k <= count; k++)
+    {
+        lookup_cvmask_derivatives(k < count ? rdp->cvgbuf[x] : 0, &offx, &offy, &cvg, &cvbit);
+
+        rgba_correct(rdp, offx, offy, r >> 14, g >> 14, b >> 14, a >> 14, cvg);
+        rdp->span_shade[k] = rdp->shade_color;
+
+        sz = (z >> 10) & 0x3fffff;
+        z_correct(rdp, offx, offy, &sz, cvg);
+        rdp->span_z[k] = sz;
+
+        rdp->span_cvg[k] = cvg;
+        rdp->span_cvbit[k] = cvbit;
+
+        r += drinc;
+        g += dginc;
+        b += dbinc;
+        a += dainc;
+        z += dzinc;
+        x += xinc;
+    }
+}
+#endif
+
+static STRICTINLINE void render_spans_1cycle_complete(struct rdp_state* rdp, int start, int end, int tilenum, int flip, int fb_size, int z_compare_en, int z_update_en, int dolod)
 {
     int zb = rdp->zb_address >> 1;
     int zbcur;
+    int inrdram;
     uint8_t offx, offy;
     struct spansigs sigs;
     uint32_t blend_en;
@@ -241,7 +466,7 @@ static void render_spans_1cycle_complete(struct rdp_state* rdp, int start, int e
 
     int cdith = 7, adith = 0;
     int r, g, b, a, z, s, t, w;
-    int sr, sg, sb, sa, sz, ss, st, sw;
+    int sr, sg, sb, sa, sz;
     int xstart, xend, xendsc;
     int sss = 0, sst = 0;
     int32_t prelodfrac;
@@ -283,6 +508,8 @@ static void render_spans_1cycle_complete(struct rdp_state* rdp, int start, int e
             compute_cvg_flip(rdp, i);
         }
 
+        inrdram = span_in_rdram(rdp, fb_size, z_compare_en || z_update_en, curpixel, length, flip);
+
 
 
         if (scdiff)
@@ -306,15 +533,14 @@ static void render_spans_1cycle_complete(struct rdp_state* rdp, int start, int e
         sigs.midspan = (lodlength == 7);
         sigs.onelessthanmid = (lodlength == 6);
 
+        tcdiv_span(rdp, s, t, w, dsinc, dtinc, dwinc, length + 2);
+
         for (j = 0; j <= length; j++)
         {
             sr = r >> 14;
             sg = g >> 14;
             sb = b >> 14;
             sa = a >> 14;
-            ss = s >> 16;
-            st = t >> 16;
-            sw = w >> 16;
             sz = (z >> 10) & 0x3fffff;
 
 
@@ -324,7 +550,7 @@ static void render_spans_1cycle_complete(struct rdp_state* rdp, int start, int e
             lookup_cvmask_derivatives(rdp->cvgbuf[x], &offx, &offy, &curpixel_cvg, &curpixel_cvbit);
 
 
-            get_texel1_1cycle(rdp, &news, &newt, s, t, w, dsinc, dtinc, dwinc, i, &sigs);
+            get_texel1_1cycle(rdp, &news, &newt, j, i, &sigs);
 
 
 
@@ -335,10 +561,11 @@ static void render_spans_1cycle_complete(struct rdp_state* rdp, int start, int e
             }
             else
             {
-                rdp->tcdiv_ptr(ss, st, sw, &sss, &sst);
+                sss = rdp->span_tcs[0];
+                sst = rdp->span_tct[0];
 
 
-                tclod_1cycle_current(rdp, &sss, &sst, news, newt, s, t, w, dsinc, dtinc, dwinc, i, prim_tile, &tile1, &sigs);
+                tclod_1cycle_current(rdp, &sss, &sst, news, newt, s, t, w, dsinc, dtinc, dwinc, i, prim_tile, &tile1, &sigs, dolod);
 
 
 
@@ -354,7 +581,7 @@ static void render_spans_1cycle_complete(struct rdp_state* rdp, int start, int e
             t += dtinc;
             w += dwinc;
 
-            tclod_1cycle_next(rdp, &news, &newt, s, t, w, dsinc, dtinc, dwinc, i, prim_tile, &newtile, &sigs, &prelodfrac);
+            tclod_1cycle_next(rdp, &news, &newt, s, t, w, dsinc, dtinc, dwinc, i, prim_tile, &newtile, &sigs, &prelodfrac, dolod);
 
             texture_pipeline_cycle(rdp, &rdp->texel1_color, &rdp->texel1_color, news, newt, newtile, 0);
 
@@ -366,14 +593,14 @@ static void render_spans_1cycle_complete(struct rdp_state* rdp, int start, int e
 
             combiner_1cycle(rdp, adith, &curpixel_cvg);
 
-            rdp->fbread1_ptr(rdp, curpixel, &curpixel_memcvg);
-            if (z_compare(rdp, zbcur, sz, dzpix, dzpixenc, &blend_en, &prewrap, &curpixel_cvg, curpixel_memcvg))
+            fbread1(rdp, fb_size, curpixel, &curpixel_memcvg, inrdram);
+            if (z_compare(rdp, z_compare_en, zbcur, sz, dzpix, dzpixenc, &blend_en, &prewrap, &curpixel_cvg, curpixel_memcvg, inrdram))
             {
                 if (blender_1cycle(rdp, &fir, &fig, &fib, cdith, blend_en, prewrap, curpixel_cvg, curpixel_cvbit))
                 {
-                    rdp->fbwrite_ptr(rdp, curpixel, fir, fig, fib, blend_en, curpixel_cvg, curpixel_memcvg);
-                    if (rdp->other_modes.z_update_en)
-                        z_store(zbcur, sz, dzpixenc);
+                    fbwrite(rdp, fb_size, curpixel, fir, fig, fib, blend_en, curpixel_cvg, curpixel_memcvg, inrdram);
+                    if (z_update_en)
+                        z_store(zbcur, sz, dzpixenc, inrdram);
                 }
             }
 
@@ -395,10 +622,11 @@ static void render_spans_1cycle_complete(struct rdp_state* rdp, int start, int e
 }
 
 
-static void render_spans_1cycle_notexel1(struct rdp_state* rdp, int start, int end, int tilenum, int flip)
+static STRICTINLINE void render_spans_1cycle_notexel1(struct rdp_state* rdp, int start, int end, int tilenum, int flip, int fb_size, int z_compare_en, int z_update_en, int dolod)
 {
     int zb = rdp->zb_address >> 1;
     int zbcur;
+    int inrdram;
     uint8_t offx, offy;
     struct spansigs sigs;
     uint32_t blend_en;
@@ -449,7 +677,7 @@ static void render_spans_1cycle_notexel1(struct rdp_state* rdp, int start, int e
 
     int cdith = 7, adith = 0;
     int r, g, b, a, z, s, t, w;
-    int sr, sg, sb, sa, sz, ss, st, sw;
+    int sr, sg, sb, sa, sz;
     int xstart, xend, xendsc;
     int sss = 0, sst = 0;
     int curpixel = 0;
@@ -490,6 +718,8 @@ static void render_spans_1cycle_notexel1(struct rdp_state* rdp, int start, int e
             compute_cvg_flip(rdp, i);
         }
 
+        inrdram = span_in_rdram(rdp, fb_size, z_compare_en || z_update_en, curpixel, length, flip);
+
         if (scdiff)
         {
             scdiff &= 0xfff;
@@ -508,15 +738,14 @@ static void render_spans_1cycle_notexel1(struct rdp_state* rdp, int start, int e
         sigs.longspan = (lodlength > 7);
         sigs.midspan = (lodlength == 7);
 
+        tcdiv_span(rdp, s, t, w, dsinc, dtinc, dwinc, length + 1);
+
         for (j = 0; j <= length; j++)
         {
             sr = r >> 14;
             sg = g >> 14;
             sb = b >> 14;
             sa = a >> 14;
-            ss = s >> 16;
-            st = t >> 16;
-            sw = w >> 16;
             sz = (z >> 10) & 0x3fffff;
 
 
@@ -526,9 +755,10 @@ static void render_spans_1cycle_notexel1(struct rdp_state* rdp, int start, int e
 
             lookup_cvmask_derivatives(rdp->cvgbuf[x], &offx, &offy, &curpixel_cvg, &curpixel_cvbit);
 
-            rdp->tcdiv_ptr(ss, st, sw, &sss, &sst);
+            sss = rdp->span_tcs[j];
+            sst = rdp->span_tct[j];
 
-            tclod_1cycle_current_simple(rdp, &sss, &sst, s, t, w, dsinc, dtinc, dwinc, i, prim_tile, &tile1, &sigs);
+            tclod_1cycle_current_simple(rdp, &sss, &sst, s, t, w, dsinc, dtinc, dwinc, i, prim_tile, &tile1, &sigs, dolod);
 
             texture_pipeline_cycle(rdp, &rdp->texel0_color, &rdp->texel0_color, sss, sst, tile1, 0);
 
@@ -540,14 +770,14 @@ static void render_spans_1cycle_notexel1(struct rdp_state* rdp, int start, int e
 
             combiner_1cycle(rdp, adith, &curpixel_cvg);
 
-            rdp->fbread1_ptr(rdp, curpixel, &curpixel_memcvg);
-            if (z_compare(rdp, zbcur, sz, dzpix, dzpixenc, &blend_en, &prewrap, &curpixel_cvg, curpixel_memcvg))
+            fbread1(rdp, fb_size, curpixel, &curpixel_memcvg, inrdram);
+            if (z_compare(rdp, z_compare_en, zbcur, sz, dzpix, dzpixenc, &blend_en, &prewrap, &curpixel_cvg, curpixel_memcvg, inrdram))
             {
                 if (blender_1cycle(rdp, &fir, &fig, &fib, cdith, blend_en, prewrap, curpixel_cvg, curpixel_cvbit))
                 {
-                    rdp->fbwrite_ptr(rdp, curpixel, fir, fig, fib, blend_en, curpixel_cvg, curpixel_memcvg);
-                    if (rdp->other_modes.z_update_en)
-                        z_store(zbcur, sz, dzpixenc);
+                    fbwrite(rdp, fb_size, curpixel, fir, fig, fib, blend_en, curpixel_cvg, curpixel_memcvg, inrdram);
+                    if (z_update_en)
+                        z_store(zbcur, sz, dzpixenc, inrdram);
                 }
             }
 
@@ -569,11 +799,11 @@ static void render_spans_1cycle_notexel1(struct rdp_state* rdp, int start, int e
 }
 
 
-static void render_spans_1cycle_notex(struct rdp_state* rdp, int start, int end, int tilenum, int flip)
+static STRICTINLINE void render_spans_1cycle_notex(struct rdp_state* rdp, int start, int end, int tilenum, int flip, int fb_size, int z_compare_en, int z_update_en)
 {
     int zb = rdp->zb_address >> 1;
     int zbcur;
-    uint8_t offx, offy;
+    int inrdram;
     uint32_t blend_en;
     uint32_t prewrap;
     uint32_t curpixel_cvg, curpixel_cvbit, curpixel_memcvg;
@@ -614,7 +844,7 @@ static void render_spans_1cycle_notex(struct rdp_state* rdp, int start, int end,
 
     int cdith = 7, adith = 0;
     int r, g, b, a, z;
-    int sr, sg, sb, sa, sz;
+    int sz;
     int xstart, xend, xendsc;
     int curpixel = 0;
     int x, length, scdiff;
@@ -651,6 +881,8 @@ static void render_spans_1cycle_notex(struct rdp_state* rdp, int start, int end,
             compute_cvg_flip(rdp, i);
         }
 
+        inrdram = span_in_rdram(rdp, fb_size, z_compare_en || z_update_en, curpixel, length, flip);
+
         if (scdiff)
         {
             scdiff &= 0xfff;
@@ -661,40 +893,30 @@ static void render_spans_1cycle_notex(struct rdp_state* rdp, int start, int end,
             z += (dzinc * scdiff);
         }
 
+        shade_span(rdp, x, xinc, length + 1, r, g, b, a, z, drinc, dginc, dbinc, dainc, dzinc);
+
         for (j = 0; j <= length; j++)
         {
-            sr = r >> 14;
-            sg = g >> 14;
-            sb = b >> 14;
-            sa = a >> 14;
-            sz = (z >> 10) & 0x3fffff;
-
-            lookup_cvmask_derivatives(rdp->cvgbuf[x], &offx, &offy, &curpixel_cvg, &curpixel_cvbit);
-
-            rgba_correct(rdp, offx, offy, sr, sg, sb, sa, curpixel_cvg);
-            z_correct(rdp, offx, offy, &sz, curpixel_cvg);
+            rdp->shade_color = rdp->span_shade[j];
+            sz = rdp->span_z[j];
+            curpixel_cvg = rdp->span_cvg[j];
+            curpixel_cvbit = rdp->span_cvbit[j];
 
             if (rdp->other_modes.f.getditherlevel < 2)
                 get_dither_noise(rdp, x, i, &cdith, &adith);
 
             combiner_1cycle(rdp, adith, &curpixel_cvg);
 
-            rdp->fbread1_ptr(rdp, curpixel, &curpixel_memcvg);
-            if (z_compare(rdp, zbcur, sz, dzpix, dzpixenc, &blend_en, &prewrap, &curpixel_cvg, curpixel_memcvg))
+            fbread1(rdp, fb_size, curpixel, &curpixel_memcvg, inrdram);
+            if (z_compare(rdp, z_compare_en, zbcur, sz, dzpix, dzpixenc, &blend_en, &prewrap, &curpixel_cvg, curpixel_memcvg, inrdram))
             {
                 if (blender_1cycle(rdp, &fir, &fig, &fib, cdith, blend_en, prewrap, curpixel_cvg, curpixel_cvbit))
                 {
-                    rdp->fbwrite_ptr(rdp, curpixel, fir, fig, fib, blend_en, curpixel_cvg, curpixel_memcvg);
-                    if (rdp->other_modes.z_update_en)
-                        z_store(zbcur, sz, dzpixenc);
+                    fbwrite(rdp, fb_size, curpixel, fir, fig, fib, blend_en, curpixel_cvg, curpixel_memcvg, inrdram);
+                    if (z_update_en)
+                        z_store(zbcur, sz, dzpixenc, inrdram);
                 }
             }
-            r += drinc;
-            g += dginc;
-            b += dbinc;
-            a += dainc;
-            z += dzinc;
-
             x += xinc;
             curpixel += xinc;
             zbcur += xinc;
@@ -703,10 +925,11 @@ static void render_spans_1cycle_notex(struct rdp_state* rdp, int start, int end,
     }
 }
 
-static void render_spans_2cycle_complete(struct rdp_state* rdp, int start, int end, int tilenum, int flip)
+static STRICTINLINE void render_spans_2cycle_complete(struct rdp_state* rdp, int start, int end, int tilenum, int flip, int fb_size, int z_compare_en, int z_update_en, int dolod)
 {
     int zb = rdp->zb_address >> 1;
     int zbcur;
+    int inrdram;
     uint8_t offx, offy;
     int32_t prelodfrac;
     struct color nexttexel1_color;
@@ -808,6 +1031,8 @@ static void render_spans_2cycle_complete(struct rdp_state* rdp, int start, int e
             compute_cvg_flip(rdp, i);
         }
 
+        inrdram = span_in_rdram(rdp, fb_size, z_compare_en || z_update_en, curpixel, length, flip);
+
 
 
 
@@ -830,6 +1055,8 @@ static void render_spans_2cycle_complete(struct rdp_state* rdp, int start, int e
 
         lodlength = length + scdiff;
 
+        tcdiv_span(rdp, s, t, w, dsinc, dtinc, dwinc, length + 2);
+
         for (j = 0; j <= length; j++)
         {
             sz = (z >> 10) & 0x3fffff;
@@ -840,13 +1067,11 @@ static void render_spans_2cycle_complete(struct rdp_state* rdp, int start, int e
                 sg = g >> 14;
                 sb = b >> 14;
                 sa = a >> 14;
-                ss = s >> 16;
-                st = t >> 16;
-                sw = w >> 16;
 
-                rdp->tcdiv_ptr(ss, st, sw, &sss, &sst);
+                sss = rdp->span_tcs[0];
+                sst = rdp->span_tct[0];
 
-                tclod_2cycle(rdp, &sss, &sst, s, t, w, dsinc, dtinc, dwinc, prim_tile, &tile1, &tile2, &rdp->lod_frac);
+                tclod_2cycle(rdp, &sss, &sst, s, t, w, dsinc, dtinc, dwinc, prim_tile, &tile1, &tile2, &rdp->lod_frac, dolod);
 
                 texture_pipeline_cycle(rdp, &rdp->texel0_color, &rdp->texel0_color, sss, sst, tile1, 0);
                 texture_pipeline_cycle(rdp, &rdp->texel1_color, &rdp->texel0_color, sss, sst, tile2, 1);
@@ -867,15 +1092,13 @@ static void render_spans_2cycle_complete(struct rdp_state* rdp, int start, int e
             t += dtinc;
             w += dwinc;
 
-            ss = s >> 16;
-            st = t >> 16;
-            sw = w >> 16;
 
-            rdp->tcdiv_ptr(ss, st, sw, &sss, &sst);
+            sss = rdp->span_tcs[j + 1];
+            sst = rdp->span_tct[j + 1];
 
             if (j < length || !rdp->span[i + 1].validline || lodlength < 3)
             {
-                tclod_2cycle(rdp, &sss, &sst, s, t, w, dsinc, dtinc, dwinc, prim_tile, &tile1, &tile2, &prelodfrac);
+                tclod_2cycle(rdp, &sss, &sst, s, t, w, dsinc, dtinc, dwinc, prim_tile, &tile1, &tile2, &prelodfrac, dolod);
 
                 texture_pipeline_cycle(rdp, &rdp->nexttexel_color, &rdp->nexttexel_color, sss, sst, tile1, 0);
                 texture_pipeline_cycle(rdp, &nexttexel1_color, &rdp->nexttexel_color, sss, sst, tile2, 1);
@@ -889,7 +1112,7 @@ static void render_spans_2cycle_complete(struct rdp_state* rdp, int start, int e
                 sw = rdp->span[i + 1].w >> 16;
                 rdp->tcdiv_ptr(ss, st, sw, &sss2, &sst2);
 
-                tclod_2cycle_next(rdp, &sss, &sst, &sss2, &sst2, s, t, w, dsinc, dtinc, dwinc, prim_tile, &tile1, &tile3, &prelodfrac, i);
+                tclod_2cycle_next(rdp, &sss, &sst, &sss2, &sst2, s, t, w, dsinc, dtinc, dwinc, prim_tile, &tile1, &tile3, &prelodfrac, i, dolod);
 
                 texture_pipeline_cycle(rdp, &rdp->nexttexel_color, &rdp->nexttexel_color, sss, sst, tile1, 0);
                 texture_pipeline_cycle(rdp, &nexttexel1_color, &rdp->nexttexel_color, sss2, sst2, tile3, 0);
@@ -899,10 +1122,10 @@ static void render_spans_2cycle_complete(struct rdp_state* rdp, int start, int e
 
             combiner_2cycle_cycle1(rdp, adith, &curpixel_cvg);
 
-            rdp->fbread2_ptr(rdp, curpixel, &curpixel_memcvg);
+            fbread2(rdp, fb_size, curpixel, &curpixel_memcvg, inrdram);
 
 
-            wen = z_compare(rdp, zbcur, sz, dzpix, dzpixenc, &blend_en, &prewrap, &curpixel_cvg, curpixel_memcvg);
+            wen = z_compare(rdp, z_compare_en, zbcur, sz, dzpix, dzpixenc, &blend_en, &prewrap, &curpixel_cvg, curpixel_memcvg, inrdram);
 
             if (wen)
                 wen &= blender_2cycle_cycle0(rdp, curpixel_cvg, curpixel_cvbit);
@@ -950,9 +1173,9 @@ static void render_spans_2cycle_complete(struct rdp_state* rdp, int start, int e
                 if (wen)
                 {
                     blender_2cycle_cycle1(rdp, &fir, &fig, &fib, cdith, blend_en, prewrap);
-                    rdp->fbwrite_ptr(rdp, curpixel, fir, fig, fib, blend_en, curpixel_cvg, curpixel_memcvg);
-                    if (rdp->other_modes.z_update_en)
-                        z_store(zbcur, sz, dzpixenc);
+                    fbwrite(rdp, fb_size, curpixel, fir, fig, fib, blend_en, curpixel_cvg, curpixel_memcvg, inrdram);
+                    if (z_update_en)
+                        z_store(zbcur, sz, dzpixenc, inrdram);
                 }
             }
 
@@ -977,10 +1200,11 @@ static void render_spans_2cycle_complete(struct rdp_state* rdp, int start, int e
 
 
 
-static void render_spans_2cycle_notexelnext(struct rdp_state* rdp, int start, int end, int tilenum, int flip)
+static STRICTINLINE void render_spans_2cycle_notexelnext(struct rdp_state* rdp, int start, int end, int tilenum, int flip, int fb_size, int z_compare_en, int z_update_en, int dolod)
 {
     int zb = rdp->zb_address >> 1;
     int zbcur;
+    int inrdram;
     uint8_t offx, offy;
     uint32_t blend_en;
     uint32_t prewrap;
@@ -1034,7 +1258,7 @@ static void render_spans_2cycle_notexelnext(struct rdp_state* rdp, int start, in
     int cdith = 7, adith = 0;
 
     int r, g, b, a, z, s, t, w;
-    int sr, sg, sb, sa, sz, ss, st, sw;
+    int sr, sg, sb, sa, sz;
     int xstart, xend, xendsc;
     int sss = 0, sst = 0;
     int curpixel = 0;
@@ -1077,6 +1301,8 @@ static void render_spans_2cycle_notexelnext(struct rdp_state* rdp, int start, in
             compute_cvg_flip(rdp, i);
         }
 
+        inrdram = span_in_rdram(rdp, fb_size, z_compare_en || z_update_en, curpixel, length, flip);
+
         if (scdiff)
         {
             scdiff &= 0xfff;
@@ -1090,6 +1316,8 @@ static void render_spans_2cycle_notexelnext(struct rdp_state* rdp, int start, in
             w += (dwinc * scdiff);
         }
 
+        tcdiv_span(rdp, s, t, w, dsinc, dtinc, dwinc, length + 2);
+
         for (j = 0; j <= length; j++)
         {
             sz = (z >> 10) & 0x3fffff;
@@ -1100,13 +1328,11 @@ static void render_spans_2cycle_notexelnext(struct rdp_state* rdp, int start, in
                 sg = g >> 14;
                 sb = b >> 14;
                 sa = a >> 14;
-                ss = s >> 16;
-                st = t >> 16;
-                sw = w >> 16;
 
-                rdp->tcdiv_ptr(ss, st, sw, &sss, &sst);
+                sss = rdp->span_tcs[0];
+                sst = rdp->span_tct[0];
 
-                tclod_2cycle(rdp, &sss, &sst, s, t, w, dsinc, dtinc, dwinc, prim_tile, &tile1, &tile2, &rdp->lod_frac);
+                tclod_2cycle(rdp, &sss, &sst, s, t, w, dsinc, dtinc, dwinc, prim_tile, &tile1, &tile2, &rdp->lod_frac, dolod);
 
                 texture_pipeline_cycle(rdp, &rdp->texel0_color, &rdp->texel0_color, sss, sst, tile1, 0);
                 texture_pipeline_cycle(rdp, &rdp->texel1_color, &rdp->texel0_color, sss, sst, tile2, 1);
@@ -1125,9 +1351,9 @@ static void render_spans_2cycle_notexelnext(struct rdp_state* rdp, int start, in
 
             combiner_2cycle_cycle1(rdp, adith, &curpixel_cvg);
 
-            rdp->fbread2_ptr(rdp, curpixel, &curpixel_memcvg);
+            fbread2(rdp, fb_size, curpixel, &curpixel_memcvg, inrdram);
 
-            wen = z_compare(rdp, zbcur, sz, dzpix, dzpixenc, &blend_en, &prewrap, &curpixel_cvg, curpixel_memcvg);
+            wen = z_compare(rdp, z_compare_en, zbcur, sz, dzpix, dzpixenc, &blend_en, &prewrap, &curpixel_cvg, curpixel_memcvg, inrdram);
 
             if (wen)
                 wen &= blender_2cycle_cycle0(rdp, curpixel_cvg, curpixel_cvbit);
@@ -1148,17 +1374,15 @@ static void render_spans_2cycle_notexelnext(struct rdp_state* rdp, int start, in
             sg = g >> 14;
             sb = b >> 14;
             sa = a >> 14;
-            ss = s >> 16;
-            st = t >> 16;
-            sw = w >> 16;
 
             lookup_cvmask_derivatives(j < length ? rdp->cvgbuf[x] : 0, &offx, &offy, &nextpixel_cvg, &curpixel_cvbit);
 
             rgba_correct(rdp, offx, offy, sr, sg, sb, sa, nextpixel_cvg);
 
-            rdp->tcdiv_ptr(ss, st, sw, &sss, &sst);
+            sss = rdp->span_tcs[j + 1];
+            sst = rdp->span_tct[j + 1];
 
-            tclod_2cycle(rdp, &sss, &sst, s, t, w, dsinc, dtinc, dwinc, prim_tile, &tile1, &tile2, &rdp->lod_frac);
+            tclod_2cycle(rdp, &sss, &sst, s, t, w, dsinc, dtinc, dwinc, prim_tile, &tile1, &tile2, &rdp->lod_frac, dolod);
 
             texture_pipeline_cycle(rdp, &rdp->texel0_color, &rdp->texel0_color, sss, sst, tile1, 0);
             texture_pipeline_cycle(rdp, &rdp->texel1_color, &rdp->texel0_color, sss, sst, tile2, 1);
@@ -1172,9 +1396,9 @@ static void render_spans_2cycle_notexelnext(struct rdp_state* rdp, int start, in
                 if (wen)
                 {
                     blender_2cycle_cycle1(rdp, &fir, &fig, &fib, cdith, blend_en, prewrap);
-                    rdp->fbwrite_ptr(rdp, curpixel, fir, fig, fib, blend_en, curpixel_cvg, curpixel_memcvg);
-                    if (rdp->other_modes.z_update_en)
-                        z_store(zbcur, sz, dzpixenc);
+                    fbwrite(rdp, fb_size, curpixel, fir, fig, fib, blend_en, curpixel_cvg, curpixel_memcvg, inrdram);
+                    if (z_update_en)
+                        z_store(zbcur, sz, dzpixenc, inrdram);
                 }
             }
 
@@ -1193,10 +1417,11 @@ static void render_spans_2cycle_notexelnext(struct rdp_state* rdp, int start, in
 }
 
 
-static void render_spans_2cycle_notexel1(struct rdp_state* rdp, int start, int end, int tilenum, int flip)
+static STRICTINLINE void render_spans_2cycle_notexel1(struct rdp_state* rdp, int start, int end, int tilenum, int flip, int fb_size, int z_compare_en, int z_update_en, int dolod)
 {
     int zb = rdp->zb_address >> 1;
     int zbcur;
+    int inrdram;
     uint8_t offx, offy;
     uint32_t blend_en;
     uint32_t prewrap;
@@ -1249,7 +1474,7 @@ static void render_spans_2cycle_notexel1(struct rdp_state* rdp, int start, int e
     int cdith = 7, adith = 0;
 
     int r, g, b, a, z, s, t, w;
-    int sr, sg, sb, sa, sz, ss, st, sw;
+    int sr, sg, sb, sa, sz;
     int xstart, xend, xendsc;
     int sss = 0, sst = 0;
     int curpixel = 0;
@@ -1292,6 +1517,8 @@ static void render_spans_2cycle_notexel1(struct rdp_state* rdp, int start, int e
             compute_cvg_flip(rdp, i);
         }
 
+        inrdram = span_in_rdram(rdp, fb_size, z_compare_en || z_update_en, curpixel, length, flip);
+
         if (scdiff)
         {
             scdiff &= 0xfff;
@@ -1305,6 +1532,8 @@ static void render_spans_2cycle_notexel1(struct rdp_state* rdp, int start, int e
             w += (dwinc * scdiff);
         }
 
+        tcdiv_span(rdp, s, t, w, dsinc, dtinc, dwinc, length + 2);
+
         for (j = 0; j <= length; j++)
         {
             sz = (z >> 10) & 0x3fffff;
@@ -1315,13 +1544,11 @@ static void render_spans_2cycle_notexel1(struct rdp_state* rdp, int start, int e
                 sg = g >> 14;
                 sb = b >> 14;
                 sa = a >> 14;
-                ss = s >> 16;
-                st = t >> 16;
-                sw = w >> 16;
 
-                rdp->tcdiv_ptr(ss, st, sw, &sss, &sst);
+                sss = rdp->span_tcs[0];
+                sst = rdp->span_tct[0];
 
-                tclod_2cycle_notexel1(rdp, &sss, &sst, s, t, w, dsinc, dtinc, dwinc, prim_tile, &tile1);
+                tclod_2cycle_notexel1(rdp, &sss, &sst, s, t, w, dsinc, dtinc, dwinc, prim_tile, &tile1, dolod);
 
                 texture_pipeline_cycle(rdp, &rdp->texel0_color, &rdp->texel0_color, sss, sst, tile1, 0);
 
@@ -1339,9 +1566,9 @@ static void render_spans_2cycle_notexel1(struct rdp_state* rdp, int start, int e
 
             combiner_2cycle_cycle1(rdp, adith, &curpixel_cvg);
 
-            rdp->fbread2_ptr(rdp, curpixel, &curpixel_memcvg);
+            fbread2(rdp, fb_size, curpixel, &curpixel_memcvg, inrdram);
 
-            wen = z_compare(rdp, zbcur, sz, dzpix, dzpixenc, &blend_en, &prewrap, &curpixel_cvg, curpixel_memcvg);
+            wen = z_compare(rdp, z_compare_en, zbcur, sz, dzpix, dzpixenc, &blend_en, &prewrap, &curpixel_cvg, curpixel_memcvg, inrdram);
 
             if (wen)
                 wen &= blender_2cycle_cycle0(rdp, curpixel_cvg, curpixel_cvbit);
@@ -1362,17 +1589,15 @@ static void render_spans_2cycle_notexel1(struct rdp_state* rdp, int start, int e
             sg = g >> 14;
             sb = b >> 14;
             sa = a >> 14;
-            ss = s >> 16;
-            st = t >> 16;
-            sw = w >> 16;
 
             lookup_cvmask_derivatives(j < length ? rdp->cvgbuf[x] : 0, &offx, &offy, &nextpixel_cvg, &curpixel_cvbit);
 
             rgba_correct(rdp, offx, offy, sr, sg, sb, sa, nextpixel_cvg);
 
-            rdp->tcdiv_ptr(ss, st, sw, &sss, &sst);
+            sss = rdp->span_tcs[j + 1];
+            sst = rdp->span_tct[j + 1];
 
-            tclod_2cycle_notexel1(rdp, &sss, &sst, s, t, w, dsinc, dtinc, dwinc, prim_tile, &tile1);
+            tclod_2cycle_notexel1(rdp, &sss, &sst, s, t, w, dsinc, dtinc, dwinc, prim_tile, &tile1, dolod);
 
             texture_pipeline_cycle(rdp, &rdp->texel0_color, &rdp->texel0_color, sss, sst, tile1, 0);
 
@@ -1385,9 +1610,9 @@ static void render_spans_2cycle_notexel1(struct rdp_state* rdp, int start, int e
                 if (wen)
                 {
                     blender_2cycle_cycle1(rdp, &fir, &fig, &fib, cdith, blend_en, prewrap);
-                    rdp->fbwrite_ptr(rdp, curpixel, fir, fig, fib, blend_en, curpixel_cvg, curpixel_memcvg);
-                    if (rdp->other_modes.z_update_en)
-                        z_store(zbcur, sz, dzpixenc);
+                    fbwrite(rdp, fb_size, curpixel, fir, fig, fib, blend_en, curpixel_cvg, curpixel_memcvg, inrdram);
+                    if (z_update_en)
+                        z_store(zbcur, sz, dzpixenc, inrdram);
                 }
             }
 
@@ -1406,11 +1631,11 @@ static void render_spans_2cycle_notexel1(struct rdp_state* rdp, int start, int e
 }
 
 
-static void render_spans_2cycle_notex(struct rdp_state* rdp, int start, int end, int tilenum, int flip)
+static STRICTINLINE void render_spans_2cycle_notex(struct rdp_state* rdp, int start, int end, int tilenum, int flip, int fb_size, int z_compare_en, int z_update_en)
 {
     int zb = rdp->zb_address >> 1;
     int zbcur;
-    uint8_t offx, offy;
+    int inrdram;
     uint32_t blend_en;
     uint32_t prewrap;
     uint32_t curpixel_cvg, curpixel_cvbit, curpixel_memcvg;
@@ -1453,7 +1678,7 @@ static void render_spans_2cycle_notex(struct rdp_state* rdp, int start, int end,
     int cdith = 7, adith = 0;
 
     int r, g, b, a, z;
-    int sr, sg, sb, sa, sz;
+    int sz;
     int xstart, xend, xendsc;
     int curpixel = 0;
     int wen;
@@ -1492,6 +1717,8 @@ static void render_spans_2cycle_notex(struct rdp_state* rdp, int start, int end,
             compute_cvg_flip(rdp, i);
         }
 
+        inrdram = span_in_rdram(rdp, fb_size, z_compare_en || z_update_en, curpixel, length, flip);
+
         if (scdiff)
         {
             scdiff &= 0xfff;
@@ -1502,20 +1729,17 @@ static void render_spans_2cycle_notex(struct rdp_state* rdp, int start, int end,
             z += (dzinc * scdiff);
         }
 
+        shade_span(rdp, x, xinc, length + 1, r, g, b, a, z, drinc, dginc, dbinc, dainc, dzinc);
+
         for (j = 0; j <= length; j++)
         {
-            sz = (z >> 10) & 0x3fffff;
+            sz = rdp->span_z[j];
+            curpixel_cvbit = rdp->span_cvbit[j];
 
             if (!j)
             {
-                sr = r >> 14;
-                sg = g >> 14;
-                sb = b >> 14;
-                sa = a >> 14;
-
-                lookup_cvmask_derivatives(rdp->cvgbuf[x], &offx, &offy, &curpixel_cvg, &curpixel_cvbit);
-
-                rgba_correct(rdp, offx, offy, sr, sg, sb, sa, curpixel_cvg);
+                rdp->shade_color = rdp->span_shade[j];
+                curpixel_cvg = rdp->span_cvg[j];
 
                 if (rdp->other_modes.f.getditherlevel < 2)
                     get_dither_noise(rdp, x, i, &cdith, &adith);
@@ -1523,13 +1747,11 @@ static void render_spans_2cycle_notex(struct rdp_state* rdp, int start, int end,
                 combiner_2cycle_cycle0(rdp, adith, curpixel_cvg, &acalpha);
             }
 
-            z_correct(rdp, offx, offy, &sz, curpixel_cvg);
-
             combiner_2cycle_cycle1(rdp, adith, &curpixel_cvg);
 
-            rdp->fbread2_ptr(rdp, curpixel, &curpixel_memcvg);
+            fbread2(rdp, fb_size, curpixel, &curpixel_memcvg, inrdram);
 
-            wen = z_compare(rdp, zbcur, sz, dzpix, dzpixenc, &blend_en, &prewrap, &curpixel_cvg, curpixel_memcvg);
+            wen = z_compare(rdp, z_compare_en, zbcur, sz, dzpix, dzpixenc, &blend_en, &prewrap, &curpixel_cvg, curpixel_memcvg, inrdram);
 
             if (wen)
                 wen &= blender_2cycle_cycle0(rdp, curpixel_cvg, curpixel_cvbit);
@@ -1538,19 +1760,8 @@ static void render_spans_2cycle_notex(struct rdp_state* rdp, int start, int end,
 
             x += xinc;
 
-            r += drinc;
-            g += dginc;
-            b += dbinc;
-            a += dainc;
-
-            sr = r >> 14;
-            sg = g >> 14;
-            sb = b >> 14;
-            sa = a >> 14;
-
-            lookup_cvmask_derivatives(j < length ? rdp->cvgbuf[x] : 0, &offx, &offy, &nextpixel_cvg, &curpixel_cvbit);
-
-            rgba_correct(rdp, offx, offy, sr, sg, sb, sa, nextpixel_cvg);
+            rdp->shade_color = rdp->span_shade[j + 1];
+            nextpixel_cvg = rdp->span_cvg[j + 1];
 
             combiner_2cycle_cycle0(rdp, adith, nextpixel_cvg, &acalpha);
 
@@ -1561,9 +1772,9 @@ static void render_spans_2cycle_notex(struct rdp_state* rdp, int start, int end,
                 if (wen)
                 {
                     blender_2cycle_cycle1(rdp, &fir, &fig, &fib, cdith, blend_en, prewrap);
-                    rdp->fbwrite_ptr(rdp, curpixel, fir, fig, fib, blend_en, curpixel_cvg, curpixel_memcvg);
-                    if (rdp->other_modes.z_update_en)
-                        z_store(zbcur, sz, dzpixenc);
+                    fbwrite(rdp, fb_size, curpixel, fir, fig, fib, blend_en, curpixel_cvg, curpixel_memcvg, inrdram);
+                    if (z_update_en)
+                        z_store(zbcur, sz, dzpixenc, inrdram);
                 }
             }
 
@@ -1572,8 +1783,6 @@ static void render_spans_2cycle_notex(struct rdp_state* rdp, int start, int end,
 
             curpixel_cvg = nextpixel_cvg;
 
-            z += dzinc;
-
             curpixel += xinc;
             zbcur += xinc;
         }
@@ -1581,6 +1790,128 @@ static void render_spans_2cycle_notex(struct rdp_state* rdp, int start, int end,
     }
 }
 
+// the span renderers above are instantiated for the most common combinations
+// of color image pixel size and Z buffer modes, which turns the per-pixel
+// checks of these modes into constants, all other combinations use the
+// generic instances that read the modes from the RDP state, the textured
+// renderers also get instances of the common modes without LOD, which leave
+// out the LOD and tile selection of every pixel
+#define RENDER_SPANS_MODE_GENERIC   0
+#define RENDER_SPANS_MODE_16        1
+#define RENDER_SPANS_MODE_16_Z      2
+#define RENDER_SPANS_MODE_32        3
+#define RENDER_SPANS_MODE_32_Z      4
+#define RENDER_SPANS_NUM_MODES      5
+
+#define RENDER_SPANS_INSTANCE(name, suffix, fb_size, z_compare_en, z_update_en, dolod) \
+    static void name##suffix(struct rdp_state* rdp, int start, int end, int tilenum, int flip) \
+    { \
+        name(rdp, start, end, tilenum, flip, fb_size, z_compare_en, z_update_en, dolod); \
+    }
+
+#define RENDER_SPANS_INSTANCES(name) \
+    RENDER_SPANS_INSTANCE(name, _generic, rdp->fb_size, rdp->other_modes.z_compare_en, rdp->other_modes.z_update_en, rdp->other_modes.f.dolod) \
+    RENDER_SPANS_INSTANCE(name, _16, PIXEL_SIZE_16BIT, 0, 0, 1) \
+    RENDER_SPANS_INSTANCE(name, _16_z, PIXEL_SIZE_16BIT, 1, 1, 1) \
+    RENDER_SPANS_INSTANCE(name, _32, PIXEL_SIZE_32BIT, 0, 0, 1) \
+    RENDER_SPANS_INSTANCE(name, _32_z, PIXEL_SIZE_32BIT, 1, 1, 1)
+
+#define RENDER_SPANS_INSTANCES_NOLOD(name) \
+    RENDER_SPANS_INSTANCE(name, _16_nolod, PIXEL_SIZE_16BIT, 0, 0, 0) \
+    RENDER_SPANS_INSTANCE(name, _16_z_nolod, PIXEL_SIZE_16BIT, 1, 1, 0) \
+    RENDER_SPANS_INSTANCE(name, _32_nolod, PIXEL_SIZE_32BIT, 0, 0, 0) \
+    RENDER_SPANS_INSTANCE(name, _32_z_nolod, PIXEL_SIZE_32BIT, 1, 1, 0)
+
+// the untextured renderers don't select any LOD, so they only have the
+// instances for the pixel size and Z buffer modes
+#define RENDER_SPANS_NOTEX_INSTANCE(name, suffix, fb_size, z_compare_en, z_update_en) \
+    static void name##suffix(struct rdp_state* rdp, int start, int end, int tilenum, int flip) \
+    { \
+        name(rdp, start, end, tilenum, flip, fb_size, z_compare_en, z_update_en); \
+    }
+
+#define RENDER_SPANS_NOTEX_INSTANCES(name) \
+    RENDER_SPANS_NOTEX_INSTANCE(name, _generic, rdp->fb_size, rdp->other_modes.z_compare_en, rdp->other_modes.z_update_en) \
+    RENDER_SPANS_NOTEX_INSTANCE(name, _16, PIXEL_SIZE_16BIT, 0, 0) \
+    RENDER_SPANS_NOTEX_INSTANCE(name, _16_z, PIXEL_SIZE_16BIT, 1, 1) \
+    RENDER_SPANS_NOTEX_INSTANCE(name, _32, PIXEL_SIZE_32BIT, 0, 0) \
+    RENDER_SPANS_NOTEX_INSTANCE(name, _32_z, PIXEL_SIZE_32BIT, 1, 1)
+
+#define RENDER_SPANS_FUNCS(name) \
+    { name##_generic, name##_16, name##_16_z, name##_32, name##_32_z }
+
+#define RENDER_SPANS_FUNCS_NOLOD(name) \
+    { name##_generic, name##_16_nolod, name##_16_z_nolod, name##_32_nolod, name##_32_z_nolod }
+
+RENDER_SPANS_INSTANCES(render_spans_1cycle_complete)
+RENDER_SPANS_INSTANCES(render_spans_1cycle_notexel1)
+RENDER_SPANS_NOTEX_INSTANCES(render_spans_1cycle_notex)
+RENDER_SPANS_INSTANCES(render_spans_2cycle_complete)
+RENDER_SPANS_INSTANCES(render_spans_2cycle_notexelnext)
+RENDER_SPANS_INSTANCES(render_spans_2cycle_notexel1)
+RENDER_SPANS_NOTEX_INSTANCES(render_spans_2cycle_notex)
+
+RENDER_SPANS_INSTANCES_NOLOD(render_spans_1cycle_complete)
+RENDER_SPANS_INSTANCES_NOLOD(render_spans_1cycle_notexel1)
+RENDER_SPANS_INSTANCES_NOLOD(render_spans_2cycle_complete)
+RENDER_SPANS_INSTANCES_NOLOD(render_spans_2cycle_notexelnext)
+RENDER_SPANS_INSTANCES_NOLOD(render_spans_2cycle_notexel1)
+
+typedef void (*render_spans_func)(struct rdp_state*, int, int, int, int);
+
+// indexed by dolod, textureuselevel0 and the mode
+static const render_spans_func render_spans_1cycle_func[2][3][RENDER_SPANS_NUM_MODES] = {
+    {
+        RENDER_SPANS_FUNCS_NOLOD(render_spans_1cycle_complete),
+        RENDER_SPANS_FUNCS_NOLOD(render_spans_1cycle_notexel1),
+        RENDER_SPANS_FUNCS(render_spans_1cycle_notex)
+    },
+    {
+        RENDER_SPANS_FUNCS(render_spans_1cycle_complete),
+        RENDER_SPANS_FUNCS(render_spans_1cycle_notexel1),
+        RENDER_SPANS_FUNCS(render_spans_1cycle_notex)
+    }
+};
+
+// indexed by dolod, textureuselevel1 and the mode
+static const render_spans_func render_spans_2cycle_func[2][4][RENDER_SPANS_NUM_MODES] = {
+    {
+        RENDER_SPANS_FUNCS_NOLOD(render_spans_2cycle_complete),
+        RENDER_SPANS_FUNCS_NOLOD(render_spans_2cycle_notexelnext),
+        RENDER_SPANS_FUNCS_NOLOD(render_spans_2cycle_notexel1),
+        RENDER_SPANS_FUNCS(render_spans_2cycle_notex)
+    },
+    {
+        RENDER_SPANS_FUNCS(render_spans_2cycle_complete),
+        RENDER_SPANS_FUNCS(render_spans_2cycle_notexelnext),
+        RENDER_SPANS_FUNCS(render_spans_2cycle_notexel1),
+        RENDER_SPANS_FUNCS(render_spans_2cycle_notex)
+    }
+};
+
+// selects the span renderer for the current cycle type and modes, which is
+// called whenever the derived modes are updated
+static void render_spans_select(struct rdp_state* rdp)
+{
+    int mode = RENDER_SPANS_MODE_GENERIC;
+    int z_compare_en = rdp->other_modes.z_compare_en;
+    int z_update_en = rdp->other_modes.z_update_en;
+    int dolod = rdp->other_modes.f.dolod != 0;
+
+    if (z_compare_en == z_update_en) {
+        if (rdp->fb_size == PIXEL_SIZE_16BIT) {
+            mode = z_compare_en ? RENDER_SPANS_MODE_16_Z : RENDER_SPANS_MODE_16;
+        } else if (rdp->fb_size == PIXEL_SIZE_32BIT) {
+            mode = z_compare_en ? RENDER_SPANS_MODE_32_Z : RENDER_SPANS_MODE_32;
+        }
+    }
+
+    if (rdp->other_modes.cycle_type == CYCLE_TYPE_1) {
+        rdp->render_spans_ptr = render_spans_1cycle_func[dolod][rdp->other_modes.f.textureuselevel0][mode];
+    } else {
+        rdp->render_spans_ptr = render_spans_2cycle_func[dolod][rdp->other_modes.f.textureuselevel1][mode];
+    }
+}
 
 static void render_spans_fill(struct rdp_state* rdp, int start, int end, int flip)
 {
@@ -1595,12 +1926,10 @@ static void render_spans_fill(struct rdp_state* rdp, int start, int end, int fli
     int fastkillbits = rdp->other_modes.image_read_en || rdp->other_modes.z_compare_en;
     int slowkillbits = rdp->other_modes.z_update_en && !rdp->other_modes.z_source_sel && !fastkillbits;
 
-    int xinc = flip ? 1 : -1;
-
     int xstart = 0, xendsc;
     int prevxstart;
     int curpixel = 0;
-    int x, length;
+    int length;
 
     for (i = start; i <= end; i++)
     {
@@ -1608,8 +1937,7 @@ static void render_spans_fill(struct rdp_state* rdp, int start, int end, int fli
         xstart = rdp->span[i].lx;
         xendsc = rdp->span[i].rx;
 
-        x = xendsc;
-        curpixel = rdp->fb_width * i + x;
+        curpixel = rdp->fb_width * i + xendsc;
         length = flip ? (xstart - xendsc) : (xendsc - xstart);
 
         if (rdp->span[i].validline)
@@ -1630,28 +1958,29 @@ static void render_spans_fill(struct rdp_state* rdp, int start, int end, int fli
 
 
 
-            for (j = 0; j <= length; j++)
+            // the span is filled from its left end, as all pixels get the same
+            // color and nothing is read back
+            if (length >= 0)
             {
+                uint32_t leftpixel = flip ? curpixel : curpixel - length;
 
                 switch(rdp->fb_size)
                 {
                 case 0:
-                    fbfill_4(rdp, curpixel);
+                    fbfill_4(rdp, leftpixel);
                     break;
                 case 1:
-                    fbfill_8(rdp, curpixel);
+                    for (j = 0; j <= length; j++)
+                        fbfill_8(rdp, leftpixel + j);
                     break;
                 case 2:
-                    fbfill_16(rdp, curpixel);
+                    fbfill_span_16(rdp, leftpixel, length + 1);
                     break;
                 case 3:
                 default:
-                    fbfill_32(rdp, curpixel);
+                    fbfill_span_32(rdp, leftpixel, length + 1);
                     break;
                 }
-
-                x += xinc;
-                curpixel += xinc;
             }
 
             if (slowkillbits && length >= 0)
@@ -1667,6 +1996,62 @@ static void render_spans_fill(struct rdp_state* rdp, int start, int end, int fli
     }
 }
 
+// checks if the copy of a primitive is an unscaled blit of a 16 bit tile to a
+// 16 bit color image, in which every 4 pixel group advances S by 4 texels and
+// nothing but the tile position and line width affects the TMEM address, so
+// that each span is a straight row copy from TMEM
+static int copy_blit_16(struct rdp_state* rdp, int tilenum, int flip)
+{
+    return flip &&
+        rdp->fb_size == PIXEL_SIZE_16BIT && !(rdp->fb_address & 1) &&
+        rdp->tile[tilenum].size == PIXEL_SIZE_16BIT && rdp->tile[tilenum].format != FORMAT_YUV &&
+        !rdp->tile[tilenum].mask_s && !rdp->tile[tilenum].shift_s &&
+        !rdp->other_modes.en_tlut && !rdp->other_modes.alpha_compare_en &&
+        !rdp->other_modes.tex_lod_en && !rdp->other_modes.persp_tex_en &&
+        rdp->spans_ds == (4 << 21) && !rdp->spans_dt;
+}
+
+static void copy_blit_span_16(struct rdp_state* rdp, int i, int tilenum)
+{
+    int32_t sss, sst, sss1, sss2, sss3;
+    int tile1 = tilenum;
+    int s = rdp->span[i].s;
+    int t = rdp->span[i].t;
+    int w = rdp->span[i].w;
+    int fb_index = rdp->fb_width * i + rdp->span[i].rx;
+    int length = rdp->span[i].lx - rdp->span[i].rx;
+    uint32_t fb = ((rdp->fb_address + PIXELS_TO_BYTES(fb_index, PIXEL_SIZE_16BIT)) & RDRAM_MASK) >> 1;
+    int j;
+
+    if (length < 0)
+        return;
+
+    // the coordinates of the first pixel take the same path as in
+    // render_spans_copy, all further pixels follow in TMEM
+    rdp->tcdiv_ptr(s >> 16, t >> 16, w >> 16, &sss, &sst);
+    tclod_copy(rdp, &sss, &sst, s, t, w, rdp->spans_ds, rdp->spans_dt, rdp->spans_dw, tilenum, &tile1);
+    tc_pipeline_copy(rdp, &sss, &sss1, &sss2, &sss3, &sst, tilenum);
+
+    uint32_t tbase = ((((rdp->tile[tilenum].line * sst) & 0x1ff) + rdp->tile[tilenum].tmem) << 2) + sss;
+    uint32_t tswap = (sst & 1) ? 2 : 0;
+
+    if (!rdram_valid_range16(fb, length + 1))
+    {
+        for (j = 0; j <= length; j++)
+        {
+            uint16_t texel = tmem16[(((tbase + j) & 0x7ff) ^ tswap) ^ WORD_ADDR_XOR];
+            PAIRWRITE16(fb + j, texel, (texel & 1) ? 3 : 0);
+        }
+        return;
+    }
+
+    for (j = 0; j <= length; j++)
+    {
+        uint16_t texel = tmem16[(((tbase + j) & 0x7ff) ^ tswap) ^ WORD_ADDR_XOR];
+        rdram_write_pair16_fast(fb + j, texel, (texel & 1) ? 3 : 0);
+    }
+}
+
 static void render_spans_copy(struct rdp_state* rdp, int start, int end, int tilenum, int flip)
 {
     int i, j, k;
@@ -1677,6 +2062,16 @@ static void render_spans_copy(struct rdp_state* rdp, int start, int end, int til
         return;
     }
 
+    if (copy_blit_16(rdp, tilenum, flip))
+    {
+        for (i = start; i <= end; i++)
+        {
+            if (rdp->span[i].validline)
+                copy_blit_span_16(rdp, i, tilenum);
+        }
+        return;
+    }
+
     int tile1 = tilenum;
     int prim_tile = tilenum;
 
@@ -1821,7 +2216,64 @@ static void render_spans_copy(struct rdp_state* rdp, int start, int end, int til
     }
 }
 
-static void edgewalker_for_prims(struct rdp_state* rdp, int32_t* ewdata)
+static STRICTINLINE int rdp_owns_lines(struct rdp_state* rdp, int32_t start, int32_t end)
+{
+    if (!rdp->stride) {
+        return 1;
+    }
+
+    if (end < start) {
+        return 0;
+    }
+
+    // check if any band between start and end belongs to this worker
+    uint32_t band_start = start / BAND_HEIGHT;
+    uint32_t band_end = end / BAND_HEIGHT;
+
+    return band_end - band_start >= rdp->stride - 1 ||
+        (rdp->offset + rdp->stride - band_start % rdp->stride) % rdp->stride <= band_end - band_start;
+}
+
+// gets a conservative range of scanlines that may be rendered by a primitive
+// command, returns false for all other commands
+static bool prim_lines(const uint32_t* args, int32_t* start, int32_t* end)
+{
+    int32_t yh, yl;
+
+    switch (CMD_ID(args)) {
+        case CMD_ID_FILL_TRIANGLE:
+        case CMD_ID_FILL_ZBUFFER_TRIANGLE:
+        case CMD_ID_TEXTURE_TRIANGLE:
+        case CMD_ID_TEXTURE_ZBUFFER_TRIANGLE:
+        case CMD_ID_SHADE_TRIANGLE:
+        case CMD_ID_SHADE_ZBUFFER_TRIANGLE:
+        case CMD_ID_SHADE_TEXTURE_TRIANGLE:
+        case CMD_ID_SHADE_TEXTURE_Z_BUFFER_TRIANGLE:
+            // same limits as in edgewalker_for_prims, but without scissor
+            yh = args[1] & 0x3fff;
+            yl = args[0] & 0x3fff;
+            yh = (yh & 0x2000) ? 0 : yh;
+            yl = (yl & 0x2000) ? -4 : (yl & 0x1000) ? 0xfff : yl;
+            break;
+        case CMD_ID_TEXTURE_RECTANGLE:
+        case CMD_ID_TEXTURE_RECTANGLE_FLIP:
+        case CMD_ID_FILL_RECTANGLE:
+            yh = args[1] & 0xfff;
+            yl = args[0] & 0xfff;
+            break;
+        default:
+            return false;
+    }
+
+    *start = yh >> 2;
+    *end = MIN(yl >> 2, 1023);
+    return true;
+}
+
+// walks the edges of a primitive and writes the span of scanline j to
+// span[j - first], the output doesn't depend on the worker that renders the
+// scanlines, so it can be shared by all of them
+static void edgewalker_walk(const struct edgewalker_state* ew, const int32_t* ewdata, struct prim_spans* ps, struct span* span, int32_t first)
 {
     int j = 0;
     int xleft = 0, xright = 0, xleft_inc = 0, xright_inc = 0;
@@ -1835,15 +2287,8 @@ static void edgewalker_for_prims(struct rdp_state* rdp, int32_t* ewdata)
     int32_t xl = 0, xm = 0, xh = 0;
     int32_t dxldy = 0, dxhdy = 0, dxmdy = 0;
 
-    if (rdp->other_modes.f.stalederivs)
-    {
-        deduce_derivatives(rdp);
-        rdp->other_modes.f.stalederivs = 0;
-    }
-
-
     flip = (ewdata[0] & 0x800000) != 0;
-    rdp->max_level = (ewdata[0] >> 19) & 7;
+    ps->max_level = (ewdata[0] >> 19) & 7;
     tilenum = (ewdata[0] >> 16) & 7;
 
 
@@ -1907,47 +2352,47 @@ static void edgewalker_for_prims(struct rdp_state* rdp, int32_t* ewdata)
 
 
 
-    rdp->spans_ds = dsdx & ~0x1f;
-    rdp->spans_dt = dtdx & ~0x1f;
-    rdp->spans_dw = dwdx & ~0x1f;
-    rdp->spans_dr = drdx & ~0x1f;
-    rdp->spans_dg = dgdx & ~0x1f;
-    rdp->spans_db = dbdx & ~0x1f;
-    rdp->spans_da = dadx & ~0x1f;
-    rdp->spans_dz = dzdx;
+    ps->spans_ds = dsdx & ~0x1f;
+    ps->spans_dt = dtdx & ~0x1f;
+    ps->spans_dw = dwdx & ~0x1f;
+    ps->spans_dr = drdx & ~0x1f;
+    ps->spans_dg = dgdx & ~0x1f;
+    ps->spans_db = dbdx & ~0x1f;
+    ps->spans_da = dadx & ~0x1f;
+    ps->spans_dz = dzdx;
 
 
-    rdp->spans_drdy = drdy >> 14;
-    rdp->spans_dgdy = dgdy >> 14;
-    rdp->spans_dbdy = dbdy >> 14;
-    rdp->spans_dady = dady >> 14;
-    rdp->spans_dzdy = dzdy >> 10;
-    rdp->spans_drdy = SIGN(rdp->spans_drdy, 13);
-    rdp->spans_dgdy = SIGN(rdp->spans_dgdy, 13);
-    rdp->spans_dbdy = SIGN(rdp->spans_dbdy, 13);
-    rdp->spans_dady = SIGN(rdp->spans_dady, 13);
-    rdp->spans_dzdy = SIGN(rdp->spans_dzdy, 22);
-    rdp->spans_cdr = rdp->spans_dr >> 14;
-    rdp->spans_cdr = SIGN(rdp->spans_cdr, 13);
-    rdp->spans_cdg = rdp->spans_dg >> 14;
-    rdp->spans_cdg = SIGN(rdp->spans_cdg, 13);
-    rdp->spans_cdb = rdp->spans_db >> 14;
-    rdp->spans_cdb = SIGN(rdp->spans_cdb, 13);
-    rdp->spans_cda = rdp->spans_da >> 14;
-    rdp->spans_cda = SIGN(rdp->spans_cda, 13);
-    rdp->spans_cdz = rdp->spans_dz >> 10;
-    rdp->spans_cdz = SIGN(rdp->spans_cdz, 22);
+    ps->spans_drdy = drdy >> 14;
+    ps->spans_dgdy = dgdy >> 14;
+    ps->spans_dbdy = dbdy >> 14;
+    ps->spans_dady = dady >> 14;
+    ps->spans_dzdy = dzdy >> 10;
+    ps->spans_drdy = SIGN(ps->spans_drdy, 13);
+    ps->spans_dgdy = SIGN(ps->spans_dgdy, 13);
+    ps->spans_dbdy = SIGN(ps->spans_dbdy, 13);
+    ps->spans_dady = SIGN(ps->spans_dady, 13);
+    ps->spans_dzdy = SIGN(ps->spans_dzdy, 22);
+    ps->spans_cdr = ps->spans_dr >> 14;
+    ps->spans_cdr = SIGN(ps->spans_cdr, 13);
+    ps->spans_cdg = ps->spans_dg >> 14;
+    ps->spans_cdg = SIGN(ps->spans_cdg, 13);
+    ps->spans_cdb = ps->spans_db >> 14;
+    ps->spans_cdb = SIGN(ps->spans_cdb, 13);
+    ps->spans_cda = ps->spans_da >> 14;
+    ps->spans_cda = SIGN(ps->spans_cda, 13);
+    ps->spans_cdz = ps->spans_dz >> 10;
+    ps->spans_cdz = SIGN(ps->spans_cdz, 22);
 
-    rdp->spans_dsdy = dsdy & ~0x7fff;
-    rdp->spans_dtdy = dtdy & ~0x7fff;
-    rdp->spans_dwdy = dwdy & ~0x7fff;
+    ps->spans_dsdy = dsdy & ~0x7fff;
+    ps->spans_dtdy = dtdy & ~0x7fff;
+    ps->spans_dwdy = dwdy & ~0x7fff;
 
 
     int dzdy_dz = (dzdy >> 16) & 0xffff;
     int dzdx_dz = (dzdx >> 16) & 0xffff;
 
-    rdp->spans_dzpix = ((dzdy_dz & 0x8000) ? ((~dzdy_dz) & 0x7fff) : dzdy_dz) + ((dzdx_dz & 0x8000) ? ((~dzdx_dz) & 0x7fff) : dzdx_dz);
-    rdp->spans_dzpix = normalize_dzpix(rdp->spans_dzpix & 0xffff) & 0xffff;
+    ps->spans_dzpix = ((dzdy_dz & 0x8000) ? ((~dzdy_dz) & 0x7fff) : dzdy_dz) + ((dzdx_dz & 0x8000) ? ((~dzdx_dz) & 0x7fff) : dzdx_dz);
+    ps->spans_dzpix = normalize_dzpix(ps->spans_dzpix & 0xffff) & 0xffff;
 
 
 
@@ -2009,7 +2454,7 @@ static void edgewalker_for_prims(struct rdp_state* rdp, int32_t* ewdata)
     int xfrac = 0;
 
     int dsdxh, dtdxh, dwdxh, drdxh, dgdxh, dbdxh, dadxh, dzdxh;
-    if (rdp->other_modes.cycle_type != CYCLE_TYPE_COPY)
+    if (ew->cycle_type != CYCLE_TYPE_COPY)
     {
         dsdxh = (dsdx >> 8) & ~1;
         dtdxh = (dtdx >> 8) & ~1;
@@ -2029,14 +2474,14 @@ static void edgewalker_for_prims(struct rdp_state* rdp, int32_t* ewdata)
 
 #define ADJUST_ATTR_PRIM()      \
 {                           \
-    rdp->span[j].s = ((s & ~0x1ff) + dsdiff - (xfrac * dsdxh)) & ~0x3ff;             \
-    rdp->span[j].t = ((t & ~0x1ff) + dtdiff - (xfrac * dtdxh)) & ~0x3ff;             \
-    rdp->span[j].w = ((w & ~0x1ff) + dwdiff - (xfrac * dwdxh)) & ~0x3ff;             \
-    rdp->span[j].r = ((r & ~0x1ff) + drdiff - (xfrac * drdxh)) & ~0x3ff;             \
-    rdp->span[j].g = ((g & ~0x1ff) + dgdiff - (xfrac * dgdxh)) & ~0x3ff;             \
-    rdp->span[j].b = ((b & ~0x1ff) + dbdiff - (xfrac * dbdxh)) & ~0x3ff;             \
-    rdp->span[j].a = ((a & ~0x1ff) + dadiff - (xfrac * dadxh)) & ~0x3ff;             \
-    rdp->span[j].z = ((z & ~0x1ff) + dzdiff - (xfrac * dzdxh)) & ~0x3ff;             \
+    span[j - first].s = ((s & ~0x1ff) + dsdiff - (xfrac * dsdxh)) & ~0x3ff;             \
+    span[j - first].t = ((t & ~0x1ff) + dtdiff - (xfrac * dtdxh)) & ~0x3ff;             \
+    span[j - first].w = ((w & ~0x1ff) + dwdiff - (xfrac * dwdxh)) & ~0x3ff;             \
+    span[j - first].r = ((r & ~0x1ff) + drdiff - (xfrac * drdxh)) & ~0x3ff;             \
+    span[j - first].g = ((g & ~0x1ff) + dgdiff - (xfrac * dgdxh)) & ~0x3ff;             \
+    span[j - first].b = ((b & ~0x1ff) + dbdiff - (xfrac * dbdxh)) & ~0x3ff;             \
+    span[j - first].a = ((a & ~0x1ff) + dadiff - (xfrac * dadxh)) & ~0x3ff;             \
+    span[j - first].z = ((z & ~0x1ff) + dzdiff - (xfrac * dzdxh)) & ~0x3ff;             \
 }
 
 
@@ -2065,14 +2510,14 @@ static void edgewalker_for_prims(struct rdp_state* rdp, int32_t* ewdata)
     else if (yl & 0x1000)
         yllimit = 0;
     else
-        yllimit = (yl & 0xfff) < rdp->clip.yl;
-    yllimit = yllimit ? yl : rdp->clip.yl;
+        yllimit = (yl & 0xfff) < ew->clip.yl;
+    yllimit = yllimit ? yl : ew->clip.yl;
 
     int ylfar = yllimit | 3;
     if ((yl >> 2) > (ylfar >> 2))
         ylfar += 4;
-    else if ((yllimit >> 2) >= 0 && (yllimit >> 2) < 1023)
-        rdp->span[(yllimit >> 2) + 1].validline = 0;
+    else if ((yllimit >> 2) >= 0 && (yllimit >> 2) < 1023 && (yllimit >> 2) + 1 >= first)
+        span[(yllimit >> 2) + 1 - first].validline = 0;
 
 
     if (yh & 0x2000)
@@ -2080,13 +2525,13 @@ static void edgewalker_for_prims(struct rdp_state* rdp, int32_t* ewdata)
     else if (yh & 0x1000)
         yhlimit = 1;
     else
-        yhlimit = (yh >= rdp->clip.yh);
-    yhlimit = yhlimit ? yh : rdp->clip.yh;
+        yhlimit = (yh >= ew->clip.yh);
+    yhlimit = yhlimit ? yh : ew->clip.yh;
 
     int yhclose = yhlimit & ~3;
 
-    int32_t clipxlshift = rdp->clip.xl << 1;
-    int32_t clipxhshift = rdp->clip.xh << 1;
+    int32_t clipxlshift = ew->clip.xl << 1;
+    int32_t clipxhshift = ew->clip.xh << 1;
     int allover = 1, allunder = 1, curover = 0, curunder = 0;
     int allinval = 1;
     int32_t curcross = 0;
@@ -2130,7 +2575,7 @@ static void edgewalker_for_prims(struct rdp_state* rdp, int32_t* ewdata)
             xrsc = curunder ? clipxhshift : (((xright >> 13) & 0x3ffe) | stickybit);
             curover = ((xrsc & 0x2000) || (xrsc & 0x1fff) >= clipxlshift);
             xrsc = curover ? clipxlshift : xrsc;
-            rdp->span[j].majorx[spix] = xrsc & 0x1fff;
+            span[j - first].majorx[spix] = xrsc & 0x1fff;
             allover &= curover;
             allunder &= curunder;
 
@@ -2140,7 +2585,7 @@ static void edgewalker_for_prims(struct rdp_state* rdp, int32_t* ewdata)
             xlsc = curunder ? clipxhshift : (((xleft >> 13) & 0x3ffe) | stickybit);
             curover = ((xlsc & 0x2000) || (xlsc & 0x1fff) >= clipxlshift);
             xlsc = curover ? clipxlshift : xlsc;
-            rdp->span[j].minorx[spix] = xlsc & 0x1fff;
+            span[j - first].minorx[spix] = xlsc & 0x1fff;
             allover &= curover;
             allunder &= curunder;
 
@@ -2150,7 +2595,7 @@ static void edgewalker_for_prims(struct rdp_state* rdp, int32_t* ewdata)
 
 
             invaly |= curcross;
-            rdp->span[j].invalyscan[spix] = invaly;
+            span[j - first].invalyscan[spix] = invaly;
             allinval &= invaly;
 
             if (!invaly)
@@ -2165,16 +2610,16 @@ static void edgewalker_for_prims(struct rdp_state* rdp, int32_t* ewdata)
 
 
 
-                rdp->span[j].unscrx = SIGN(xright >> 16, 12);
+                span[j - first].unscrx = SIGN(xright >> 16, 12);
                 xfrac = (xright >> 8) & 0xff;
                 ADJUST_ATTR_PRIM();
             }
 
             if (spix == 3)
             {
-                rdp->span[j].lx = maxxmx;
-                rdp->span[j].rx = minxhx;
-                rdp->span[j].validline  = !allinval && !allover && !allunder && (!rdp->scfield || (rdp->scfield && !(rdp->sckeepodd ^ (j & 1)))) && (!rdp->stride || j % rdp->stride == rdp->offset);
+                span[j - first].lx = maxxmx;
+                span[j - first].rx = minxhx;
+                span[j - first].validline  = !allinval && !allover && !allunder && (!ew->scfield || (ew->scfield && !(ew->sckeepodd ^ (j & 1))));
 
             }
 
@@ -2224,7 +2669,7 @@ static void edgewalker_for_prims(struct rdp_state* rdp, int32_t* ewdata)
             xrsc = curunder ? clipxhshift : (((xright >> 13) & 0x3ffe) | stickybit);
             curover = ((xrsc & 0x2000) || (xrsc & 0x1fff) >= clipxlshift);
             xrsc = curover ? clipxlshift : xrsc;
-            rdp->span[j].majorx[spix] = xrsc & 0x1fff;
+            span[j - first].majorx[spix] = xrsc & 0x1fff;
             allover &= curover;
             allunder &= curunder;
 
@@ -2234,14 +2679,14 @@ static void edgewalker_for_prims(struct rdp_state* rdp, int32_t* ewdata)
             xlsc = curunder ? clipxhshift : (((xleft >> 13) & 0x3ffe) | stickybit);
             curover = ((xlsc & 0x2000) || (xlsc & 0x1fff) >= clipxlshift);
             xlsc = curover ? clipxlshift : xlsc;
-            rdp->span[j].minorx[spix] = xlsc & 0x1fff;
+            span[j - first].minorx[spix] = xlsc & 0x1fff;
             allover &= curover;
             allunder &= curunder;
 
             curcross = ((xright ^ (1 << 27)) & (0x3fff << 14)) < ((xleft ^ (1 << 27)) & (0x3fff << 14));
 
             invaly |= curcross;
-            rdp->span[j].invalyscan[spix] = invaly;
+            span[j - first].invalyscan[spix] = invaly;
             allinval &= invaly;
 
             if (!invaly)
@@ -2252,16 +2697,16 @@ static void edgewalker_for_prims(struct rdp_state* rdp, int32_t* ewdata)
 
             if (spix == ldflag)
             {
-                rdp->span[j].unscrx  = SIGN(xright >> 16, 12);
+                span[j - first].unscrx  = SIGN(xright >> 16, 12);
                 xfrac = (xright >> 8) & 0xff;
                 ADJUST_ATTR_PRIM();
             }
 
             if (spix == 3)
             {
-                rdp->span[j].lx = minxmx;
-                rdp->span[j].rx = maxxhx;
-                rdp->span[j].validline  = !allinval && !allover && !allunder && (!rdp->scfield || (rdp->scfield && !(rdp->sckeepodd ^ (j & 1)))) && (!rdp->stride || j % rdp->stride == rdp->offset);
+                span[j - first].lx = minxmx;
+                span[j - first].rx = maxxhx;
+                span[j - first].validline  = !allinval && !allover && !allunder && (!ew->scfield || (ew->scfield && !(ew->sckeepodd ^ (j & 1))));
             }
 
         }
@@ -2277,127 +2722,13 @@ static void edgewalker_for_prims(struct rdp_state* rdp, int32_t* ewdata)
     }
     }
 
-
-
-
-    switch(rdp->other_modes.cycle_type)
-    {
-        case CYCLE_TYPE_1:
-            switch (rdp->other_modes.f.textureuselevel0)
-            {
-                case 0: render_spans_1cycle_complete(rdp, yhlimit >> 2, yllimit >> 2, tilenum, flip); break;
-                case 1: render_spans_1cycle_notexel1(rdp, yhlimit >> 2, yllimit >> 2, tilenum, flip); break;
-                case 2: default: render_spans_1cycle_notex(rdp, yhlimit >> 2, yllimit >> 2, tilenum, flip); break;
-            }
-            break;
-        case CYCLE_TYPE_2:
-            switch (rdp->other_modes.f.textureuselevel1)
-            {
-                case 0: render_spans_2cycle_complete(rdp, yhlimit >> 2, yllimit >> 2, tilenum, flip); break;
-                case 1: render_spans_2cycle_notexelnext(rdp, yhlimit >> 2, yllimit >> 2, tilenum, flip); break;
-                case 2: render_spans_2cycle_notexel1(rdp, yhlimit >> 2, yllimit >> 2, tilenum, flip); break;
-                case 3: default: render_spans_2cycle_notex(rdp, yhlimit >> 2, yllimit >> 2, tilenum, flip); break;
-            }
-            break;
-        case CYCLE_TYPE_COPY: render_spans_copy(rdp, yhlimit >> 2, yllimit >> 2, tilenum, flip); break;
-        case CYCLE_TYPE_FILL: render_spans_fill(rdp, yhlimit >> 2, yllimit >> 2, flip); break;
-        default: msg_error("cycle_type %d", rdp->other_modes.cycle_type); break;
-    }
-
-
-}
-
-static void rasterizer_init(struct rdp_state* rdp)
-{
-    rdp->clip.xh = 0x2000;
-    rdp->clip.yh = 0x2000;
-}
-
-void rdp_tri_noshade(struct rdp_state* rdp, const uint32_t* args)
-{
-    int32_t ewdata[CMD_MAX_INTS];
-    memcpy(&ewdata[0], args, 8 * sizeof(int32_t));
-    memset(&ewdata[8], 0, 36 * sizeof(int32_t));
-    edgewalker_for_prims(rdp, ewdata);
-}
-
-void rdp_tri_noshade_z(struct rdp_state* rdp, const uint32_t* args)
-{
-    int32_t ewdata[CMD_MAX_INTS];
-    memcpy(&ewdata[0], args, 8 * sizeof(int32_t));
-    memset(&ewdata[8], 0, 32 * sizeof(int32_t));
-    memcpy(&ewdata[40], args + 8, 4 * sizeof(int32_t));
-    edgewalker_for_prims(rdp, ewdata);
-}
-
-void rdp_tri_tex(struct rdp_state* rdp, const uint32_t* args)
-{
-    int32_t ewdata[CMD_MAX_INTS];
-    memcpy(&ewdata[0], args, 8 * sizeof(int32_t));
-    memset(&ewdata[8], 0, 16 * sizeof(int32_t));
-    memcpy(&ewdata[24], args + 8, 16 * sizeof(int32_t));
-    memset(&ewdata[40], 0, 4 * sizeof(int32_t));
-    edgewalker_for_prims(rdp, ewdata);
-}
-
-void rdp_tri_tex_z(struct rdp_state* rdp, const uint32_t* args)
-{
-    int32_t ewdata[CMD_MAX_INTS];
-    memcpy(&ewdata[0], args, 8 * sizeof(int32_t));
-    memset(&ewdata[8], 0, 16 * sizeof(int32_t));
-    memcpy(&ewdata[24], args + 8, 16 * sizeof(int32_t));
-    memcpy(&ewdata[40], args + 24, 4 * sizeof(int32_t));
-
-
-
-
-
-
-    edgewalker_for_prims(rdp, ewdata);
-
-
-}
-
-void rdp_tri_shade(struct rdp_state* rdp, const uint32_t* args)
-{
-    int32_t ewdata[CMD_MAX_INTS];
-    memcpy(&ewdata[0], args, 24 * sizeof(int32_t));
-    memset(&ewdata[24], 0, 20 * sizeof(int32_t));
-    edgewalker_for_prims(rdp, ewdata);
-}
-
-void rdp_tri_shade_z(struct rdp_state* rdp, const uint32_t* args)
-{
-    int32_t ewdata[CMD_MAX_INTS];
-    memcpy(&ewdata[0], args, 24 * sizeof(int32_t));
-    memset(&ewdata[24], 0, 16 * sizeof(int32_t));
-    memcpy(&ewdata[40], args + 24, 4 * sizeof(int32_t));
-    edgewalker_for_prims(rdp, ewdata);
-}
-
-void rdp_tri_texshade(struct rdp_state* rdp, const uint32_t* args)
-{
-    int32_t ewdata[CMD_MAX_INTS];
-    memcpy(&ewdata[0], args, 40 * sizeof(int32_t));
-    memset(&ewdata[40], 0, 4 * sizeof(int32_t));
-    edgewalker_for_prims(rdp, ewdata);
-}
-
-void rdp_tri_texshade_z(struct rdp_state* rdp, const uint32_t* args)
-{
-    int32_t ewdata[CMD_MAX_INTS];
-    memcpy(&ewdata[0], args, CMD_MAX_SIZE);
-
-
-
-
-
-    edgewalker_for_prims(rdp, ewdata);
-
-
+    ps->start = yhlimit >> 2;
+    ps->end = yllimit >> 2;
+    ps->tilenum = tilenum;
+    ps->flip = flip;
 }
 
-void rdp_tex_rect(struct rdp_state* rdp, const uint32_t* args)
+static void edgewalker_input_tex_rect(const uint32_t* args, int cycle_type, int32_t* ewdata)
 {
     uint32_t tilenum    = (args[1] >> 24) & 0x7;
     uint32_t xl = (args[0] >> 12) & 0xfff;
@@ -2413,13 +2744,12 @@ void rdp_tex_rect(struct rdp_state* rdp, const uint32_t* args)
     dsdx = SIGN16(dsdx);
     dtdy = SIGN16(dtdy);
 
-    if (rdp->other_modes.cycle_type == CYCLE_TYPE_FILL || rdp->other_modes.cycle_type == CYCLE_TYPE_COPY)
+    if (cycle_type == CYCLE_TYPE_FILL || cycle_type == CYCLE_TYPE_COPY)
         yl |= 3;
 
     uint32_t xlint = (xl >> 2) & 0x3ff;
     uint32_t xhint = (xh >> 2) & 0x3ff;
 
-    int32_t ewdata[CMD_MAX_INTS];
     ewdata[0] = (0x24 << 24) | ((0x80 | tilenum) << 16) | yl;
     ewdata[1] = (yl << 16) | yh;
     ewdata[2] = (xlint << 16) | ((xl & 3) << 14);
@@ -2446,14 +2776,9 @@ void rdp_tex_rect(struct rdp_state* rdp, const uint32_t* args)
     ewdata[38] = (dtdy & 0x1f) << 11;
     ewdata[39] = 0;
     memset(&ewdata[40], 0, 4 * sizeof(int32_t));
-
-
-
-    edgewalker_for_prims(rdp, ewdata);
-
 }
 
-void rdp_tex_rect_flip(struct rdp_state* rdp, const uint32_t* args)
+static void edgewalker_input_tex_rect_flip(const uint32_t* args, int cycle_type, int32_t* ewdata)
 {
     uint32_t tilenum    = (args[1] >> 24) & 0x7;
     uint32_t xl = (args[0] >> 12) & 0xfff;
@@ -2469,13 +2794,12 @@ void rdp_tex_rect_flip(struct rdp_state* rdp, const uint32_t* args)
     dsdx = SIGN16(dsdx);
     dtdy = SIGN16(dtdy);
 
-    if (rdp->other_modes.cycle_type == CYCLE_TYPE_FILL || rdp->other_modes.cycle_type == CYCLE_TYPE_COPY)
+    if (cycle_type == CYCLE_TYPE_FILL || cycle_type == CYCLE_TYPE_COPY)
         yl |= 3;
 
     uint32_t xlint = (xl >> 2) & 0x3ff;
     uint32_t xhint = (xh >> 2) & 0x3ff;
 
-    int32_t ewdata[CMD_MAX_INTS];
     ewdata[0] = (0x25 << 24) | ((0x80 | tilenum) << 16) | yl;
     ewdata[1] = (yl << 16) | yh;
     ewdata[2] = (xlint << 16) | ((xl & 3) << 14);
@@ -2503,24 +2827,21 @@ void rdp_tex_rect_flip(struct rdp_state* rdp, const uint32_t* args)
     ewdata[38] = (dsdx & 0x1f) << 27;
     ewdata[39] = 0;
     memset(&ewdata[40], 0, 4 * sizeof(int32_t));
-
-    edgewalker_for_prims(rdp, ewdata);
 }
 
-void rdp_fill_rect(struct rdp_state* rdp, const uint32_t* args)
+static void edgewalker_input_fill_rect(const uint32_t* args, int cycle_type, int32_t* ewdata)
 {
     uint32_t xl = (args[0] >> 12) & 0xfff;
     uint32_t yl = (args[0] >>  0) & 0xfff;
     uint32_t xh = (args[1] >> 12) & 0xfff;
     uint32_t yh = (args[1] >>  0) & 0xfff;
 
-    if (rdp->other_modes.cycle_type == CYCLE_TYPE_FILL || rdp->other_modes.cycle_type == CYCLE_TYPE_COPY)
+    if (cycle_type == CYCLE_TYPE_FILL || cycle_type == CYCLE_TYPE_COPY)
         yl |= 3;
 
     uint32_t xlint = (xl >> 2) & 0x3ff;
     uint32_t xhint = (xh >> 2) & 0x3ff;
 
-    int32_t ewdata[CMD_MAX_INTS];
     ewdata[0] = (0x3680 << 16) | yl;
     ewdata[1] = (yl << 16) | yh;
     ewdata[2] = (xlint << 16) | ((xl & 3) << 14);
@@ -2530,8 +2851,230 @@ void rdp_fill_rect(struct rdp_state* rdp, const uint32_t* args)
     ewdata[6] = (xlint << 16) | ((xl & 3) << 14);
     ewdata[7] = 0;
     memset(&ewdata[8], 0, 36 * sizeof(int32_t));
+}
+
+// converts the parameters of a primitive command to the layout of the
+// shaded, textured and Z-buffered triangle used by the edge walker
+static void edgewalker_input(const uint32_t* args, int cycle_type, int32_t* ewdata)
+{
+    switch (CMD_ID(args)) {
+        case CMD_ID_FILL_TRIANGLE:
+            memcpy(&ewdata[0], args, 8 * sizeof(int32_t));
+            memset(&ewdata[8], 0, 36 * sizeof(int32_t));
+            break;
+        case CMD_ID_FILL_ZBUFFER_TRIANGLE:
+            memcpy(&ewdata[0], args, 8 * sizeof(int32_t));
+            memset(&ewdata[8], 0, 32 * sizeof(int32_t));
+            memcpy(&ewdata[40], args + 8, 4 * sizeof(int32_t));
+            break;
+        case CMD_ID_TEXTURE_TRIANGLE:
+            memcpy(&ewdata[0], args, 8 * sizeof(int32_t));
+            memset(&ewdata[8], 0, 16 * sizeof(int32_t));
+            memcpy(&ewdata[24], args + 8, 16 * sizeof(int32_t));
+            memset(&ewdata[40], 0, 4 * sizeof(int32_t));
+            break;
+        case CMD_ID_TEXTURE_ZBUFFER_TRIANGLE:
+            memcpy(&ewdata[0], args, 8 * sizeof(int32_t));
+            memset(&ewdata[8], 0, 16 * sizeof(int32_t));
+            memcpy(&ewdata[24], args + 8, 16 * sizeof(int32_t));
+            memcpy(&ewdata[40], args + 24, 4 * sizeof(int32_t));
+            break;
+        case CMD_ID_SHADE_TRIANGLE:
+            memcpy(&ewdata[0], args, 24 * sizeof(int32_t));
+            memset(&ewdata[24], 0, 20 * sizeof(int32_t));
+            break;
+        case CMD_ID_SHADE_ZBUFFER_TRIANGLE:
+            memcpy(&ewdata[0], args, 24 * sizeof(int32_t));
+            memset(&ewdata[24], 0, 16 * sizeof(int32_t));
+            memcpy(&ewdata[40], args + 24, 4 * sizeof(int32_t));
+            break;
+        case CMD_ID_SHADE_TEXTURE_TRIANGLE:
+            memcpy(&ewdata[0], args, 40 * sizeof(int32_t));
+            memset(&ewdata[40], 0, 4 * sizeof(int32_t));
+            break;
+        case CMD_ID_SHADE_TEXTURE_Z_BUFFER_TRIANGLE:
+            memcpy(&ewdata[0], args, CMD_MAX_SIZE);
+            break;
+        case CMD_ID_TEXTURE_RECTANGLE:
+            edgewalker_input_tex_rect(args, cycle_type, ewdata);
+            break;
+        case CMD_ID_TEXTURE_RECTANGLE_FLIP:
+            edgewalker_input_tex_rect_flip(args, cycle_type, ewdata);
+            break;
+        case CMD_ID_FILL_RECTANGLE:
+            edgewalker_input_fill_rect(args, cycle_type, ewdata);
+            break;
+    }
+}
+
+static void edgewalker_render(struct rdp_state* rdp, const struct prim_spans* ps)
+{
+    if (rdp->other_modes.f.stalederivs)
+    {
+        deduce_derivatives(rdp);
+        rdp->other_modes.f.stalederivs = 0;
+    }
+
+    rdp->max_level = ps->max_level;
+
+    rdp->spans_ds = ps->spans_ds;
+    rdp->spans_dt = ps->spans_dt;
+    rdp->spans_dw = ps->spans_dw;
+    rdp->spans_dr = ps->spans_dr;
+    rdp->spans_dg = ps->spans_dg;
+    rdp->spans_db = ps->spans_db;
+    rdp->spans_da = ps->spans_da;
+    rdp->spans_dz = ps->spans_dz;
+    rdp->spans_dzpix = ps->spans_dzpix;
+
+    rdp->spans_drdy = ps->spans_drdy;
+    rdp->spans_dgdy = ps->spans_dgdy;
+    rdp->spans_dbdy = ps->spans_dbdy;
+    rdp->spans_dady = ps->spans_dady;
+    rdp->spans_dzdy = ps->spans_dzdy;
+    rdp->spans_cdr = ps->spans_cdr;
+    rdp->spans_cdg = ps->spans_cdg;
+    rdp->spans_cdb = ps->spans_cdb;
+    rdp->spans_cda = ps->spans_cda;
+    rdp->spans_cdz = ps->spans_cdz;
+
+    rdp->spans_dsdy = ps->spans_dsdy;
+    rdp->spans_dtdy = ps->spans_dtdy;
+    rdp->spans_dwdy = ps->spans_dwdy;
+
+    int start = ps->start;
+    int end = ps->end;
+    int tilenum = ps->tilenum;
+    int flip = ps->flip;
+
+    switch(rdp->other_modes.cycle_type)
+    {
+        case CYCLE_TYPE_1:
+        case CYCLE_TYPE_2: rdp->render_spans_ptr(rdp, start, end, tilenum, flip); break;
+        case CYCLE_TYPE_COPY: render_spans_copy(rdp, start, end, tilenum, flip); break;
+        case CYCLE_TYPE_FILL: render_spans_fill(rdp, start, end, flip); break;
+        default: msg_error("cycle_type %d", rdp->other_modes.cycle_type); break;
+    }
+}
+
+// renders a primitive that has already been walked by another worker, by
+// copying the spans of the scanlines that belong to this worker from the
+// shared buffer and invalidating the other ones
+static void edgewalker_render_shared(struct rdp_state* rdp, const struct prim_spans* ps, const struct span* span, int32_t first)
+{
+    if (ps->start <= ps->end) {
+        // the line after the last one is also read for the LOD calculation
+        int32_t end = MIN(ps->end + 1, 1023);
+        for (int32_t j = ps->start; j <= end; j++) {
+            if (rdp_owns_lines(rdp, j, j)) {
+                rdp->span[j] = span[j - first];
+            } else {
+                rdp->span[j].validline = 0;
+            }
+        }
+    }
+
+    edgewalker_render(rdp, ps);
+}
+
+static void edgewalker_get_state(struct rdp_state* rdp, struct edgewalker_state* ew)
+{
+    ew->clip = rdp->clip;
+    ew->scfield = rdp->scfield;
+    ew->sckeepodd = rdp->sckeepodd;
+    ew->cycle_type = rdp->other_modes.cycle_type;
+}
+
+// updates the edge walker states for a command without running it, so
+// primitives can be walked ahead of the workers that render them
+static void edgewalker_update_state(struct edgewalker_state* ew, const uint32_t* args)
+{
+    switch (CMD_ID(args)) {
+        case CMD_ID_SET_SCISSOR:
+            ew->clip.xh = (args[0] >> 12) & 0xfff;
+            ew->clip.yh = (args[0] >>  0) & 0xfff;
+            ew->clip.xl = (args[1] >> 12) & 0xfff;
+            ew->clip.yl = (args[1] >>  0) & 0xfff;
+            ew->scfield = (args[1] >> 25) & 1;
+            ew->sckeepodd = (args[1] >> 24) & 1;
+            break;
+        case CMD_ID_SET_OTHER_MODES:
+            ew->cycle_type = (args[0] >> 20) & 3;
+            break;
+    }
+}
+
+static void edgewalker_for_prims(struct rdp_state* rdp, const uint32_t* args)
+{
+    struct edgewalker_state ew;
+    struct prim_spans ps;
+    int32_t ewdata[CMD_MAX_INTS];
 
-    edgewalker_for_prims(rdp, ewdata);
+    edgewalker_get_state(rdp, &ew);
+    edgewalker_input(args, ew.cycle_type, ewdata);
+    edgewalker_walk(&ew, ewdata, &ps, rdp->span, 0);
+    edgewalker_render(rdp, &ps);
+}
+
+static void rasterizer_init(struct rdp_state* rdp)
+{
+    rdp->clip.xh = 0x2000;
+    rdp->clip.yh = 0x2000;
+}
+
+void rdp_tri_noshade(struct rdp_state* rdp, const uint32_t* args)
+{
+    edgewalker_for_prims(rdp, args);
+}
+
+void rdp_tri_noshade_z(struct rdp_state* rdp, const uint32_t* args)
+{
+    edgewalker_for_prims(rdp, args);
+}
+
+void rdp_tri_tex(struct rdp_state* rdp, const uint32_t* args)
+{
+    edgewalker_for_prims(rdp, args);
+}
+
+void rdp_tri_tex_z(struct rdp_state* rdp, const uint32_t* args)
+{
+    edgewalker_for_prims(rdp, args);
+}
+
+void rdp_tri_shade(struct rdp_state* rdp, const uint32_t* args)
+{
+    edgewalker_for_prims(rdp, args);
+}
+
+void rdp_tri_shade_z(struct rdp_state* rdp, const uint32_t* args)
+{
+    edgewalker_for_prims(rdp, args);
+}
+
+void rdp_tri_texshade(struct rdp_state* rdp, const uint32_t* args)
+{
+    edgewalker_for_prims(rdp, args);
+}
+
+void rdp_tri_texshade_z(struct rdp_state* rdp, const uint32_t* args)
+{
+    edgewalker_for_prims(rdp, args);
+}
+
+void rdp_tex_rect(struct rdp_state* rdp, const uint32_t* args)
+{
+    edgewalker_for_prims(rdp, args);
+}
+
+void rdp_tex_rect_flip(struct rdp_state* rdp, const uint32_t* args)
+{
+    edgewalker_for_prims(rdp, args);
+}
+
+void rdp_fill_rect(struct rdp_state* rdp, const uint32_t* args)
+{
+    edgewalker_for_prims(rdp, args);
 }
 
 void rdp_set_prim_depth(struct rdp_state* rdp, const uint32_t* args)
@@ -16,12 +16,31 @@
 #define PIXEL_SIZE_16BIT        2
 #define PIXEL_SIZE_32BIT        3
 
+// height of the scanline bands that are assigned to the workers in turns
+#define BAND_HEIGHT             8
+
+// number of pixels prepared by shade_span and tcdiv_span, which covers the
+// longest span plus the pixel after it, rounded up to whole groups of four
+// pixels
+#define SHADE_SPAN_SIZE         1028
+
 #define CYCLE_TYPE_1            0
 #define CYCLE_TYPE_2            1
 #define CYCLE_TYPE_COPY         2
 #define CYCLE_TYPE_FILL         3
 
 
+#define COMBINER_KERNEL_FULL    0
+#define COMBINER_KERNEL_ADD     1
+#define COMBINER_KERNEL_CONST   2
+
+
+#define BLENDER_KERNEL_FULL         0
+#define BLENDER_KERNEL_MEMORY       1
+#define BLENDER_KERNEL_INV_ALPHA    2
+#define BLENDER_KERNEL_PASS         3
+
+
 #define FORMAT_RGBA             0
 #define FORMAT_YUV              1
 #define FORMAT_CI               2
@@ -142,6 +161,8 @@ struct tile
         int clampens, clampent;
         int masksclamped, masktclamped;
         int notlutswitch, tlutswitch;
+        int maskbitss, maskbitst;
+        int shiftls, shiftrs, shiftlt, shiftrt;
     } f;
 };
 
@@ -156,6 +177,52 @@ struct span
     int32_t invalyscan[4];
 };
 
+// states of other commands that are used by the edge walker
+struct edgewalker_state
+{
+    struct rectangle clip;
+    int scfield;
+    int sckeepodd;
+    int cycle_type;
+};
+
+// edge walker output of a single primitive, apart from the spans themselves
+struct prim_spans
+{
+    // range of scanlines to render
+    int32_t start;
+    int32_t end;
+
+    int tilenum;
+    int flip;
+    uint32_t max_level;
+
+    int spans_ds;
+    int spans_dt;
+    int spans_dw;
+    int spans_dr;
+    int spans_dg;
+    int spans_db;
+    int spans_da;
+    int spans_dz;
+    int spans_dzpix;
+
+    int spans_drdy;
+    int spans_dgdy;
+    int spans_dbdy;
+    int spans_dady;
+    int spans_dzdy;
+    int spans_cdr;
+    int spans_cdg;
+    int spans_cdb;
+    int spans_cda;
+    int spans_cdz;
+
+    int spans_dsdy;
+    int spans_dtdy;
+    int spans_dwdy;
+};
+
 struct combiner_inputs
 {
     int sub_a_rgb0;
@@ -179,6 +246,8 @@ struct combiner_inputs
 
 struct rdp_state
 {
+    // number of workers and index of this worker, which renders every
+    // stride-th band of scanlines starting at band offset
     uint32_t stride;
     uint32_t offset;
 
@@ -258,9 +327,12 @@ struct rdp_state
 
     int32_t blender_shade_alpha;
 
+    // kernels of the blender equation of each cycle, selected from the
+    // second alpha input and whether the first alpha input is zero
+    int blender_kernel[2];
+
     struct color blend_color;
     struct color fog_color;
-    struct color inv_pixel_color;
     struct color blended_pixel_color;
 
     // combiner
@@ -284,6 +356,13 @@ struct rdp_state
     int32_t *combiner_alphamul[2];
     int32_t *combiner_alphaadd[2];
 
+    // kernels of the color and alpha equations of each cycle, either the
+    // full equation, only the addend if the multiplier is zero, or the result
+    // in combiner_const if all inputs are constant
+    int combiner_rgb_kernel[2];
+    int combiner_alpha_kernel[2];
+    struct color combiner_const[2];
+
     struct color prim_color;
     struct color env_color;
     struct color key_scale;
@@ -296,10 +375,6 @@ struct rdp_state
     void (*tcdiv_ptr)(int32_t, int32_t, int32_t, int32_t*, int32_t*);
 
     // fbuffer
-    void (*fbread1_ptr)(struct rdp_state*, uint32_t, uint32_t*);
-    void (*fbread2_ptr)(struct rdp_state*, uint32_t, uint32_t*);
-    void (*fbwrite_ptr)(struct rdp_state*, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t);
-
     int fb_format;
     int fb_size;
     int fb_width;
@@ -307,6 +382,7 @@ struct rdp_state
     uint32_t fill_color;
 
     // rasterizer
+    void (*render_spans_ptr)(struct rdp_state*, int, int, int, int);
     struct rectangle clip;
     int scfield;
     int sckeepodd;
@@ -323,8 +399,20 @@ struct rdp_state
     // coverage
     uint8_t cvgbuf[1024];
 
-    // tmem
-    uint8_t tmem[0x1000];
+    // shade colors, Z values and coverage of the pixels of the current span
+    struct color span_shade[SHADE_SPAN_SIZE];
+    int32_t span_z[SHADE_SPAN_SIZE];
+    uint8_t span_cvg[SHADE_SPAN_SIZE];
+    uint8_t span_cvbit[SHADE_SPAN_SIZE];
+
+    // divided texture coordinates of the pixels of the current span
+    int32_t span_tcs[SHADE_SPAN_SIZE];
+    int32_t span_tct[SHADE_SPAN_SIZE];
+
+    // tmem, which points either to tmem_buf or to a TMEM snapshot that is
+    // shared by all workers
+    uint8_t* tmem;
+    uint8_t tmem_buf[0x1000];
 
     // zbuffer
     uint32_t zb_address;
@@ -423,20 +511,6 @@ static void deduce_derivatives(struct rdp_state* rdp);
 
 static void deduce_derivatives(struct rdp_state* rdp)
 {
-    int special_bsel0, special_bsel1;
-
-
-    rdp->other_modes.f.partialreject_1cycle = (rdp->blender2b_a[0] == &rdp->inv_pixel_color.a && rdp->blender1b_a[0] == &rdp->pixel_color.a);
-    rdp->other_modes.f.partialreject_2cycle = (rdp->blender2b_a[1] == &rdp->inv_pixel_color.a && rdp->blender1b_a[1] == &rdp->pixel_color.a);
-
-
-    special_bsel0 = (rdp->blender2b_a[0] == &rdp->memory_color.a);
-    special_bsel1 = (rdp->blender2b_a[1] == &rdp->memory_color.a);
-
-
-    rdp->other_modes.f.realblendershiftersneeded = (special_bsel0 && rdp->other_modes.cycle_type == CYCLE_TYPE_1) || (special_bsel1 && rdp->other_modes.cycle_type == CYCLE_TYPE_2);
-    rdp->other_modes.f.interpixelblendershiftersneeded = (special_bsel0 && rdp->other_modes.cycle_type == CYCLE_TYPE_2);
-
     rdp->other_modes.f.rgb_alpha_dither = (rdp->other_modes.rgb_dither_sel << 2) | rdp->other_modes.alpha_dither_sel;
 
     rdp->tcdiv_ptr = tcdiv_func[rdp->other_modes.persp_tex_en];
@@ -508,6 +582,8 @@ static void deduce_derivatives(struct rdp_state* rdp)
         rdp->other_modes.f.getditherlevel = 2;
 
     rdp->other_modes.f.dolod = rdp->other_modes.tex_lod_en || lodfracused;
+
+    render_spans_select(rdp);
 }
 
 void rdp_create(struct rdp_state** rdp, uint32_t stride, uint32_t offset)
@@ -601,14 +677,7 @@ void rdp_set_other_modes(struct rdp_state* rdp, const uint32_t* args)
     rdp->other_modes.dither_alpha_en     = (args[1] >>  1) & 1;
     rdp->other_modes.alpha_compare_en    = (args[1] >>  0) & 1;
 
-    set_blender_input(rdp, 0, 0, &rdp->blender1a_r[0], &rdp->blender1a_g[0], &rdp->blender1a_b[0], &rdp->blender1b_a[0],
-                      rdp->other_modes.blend_m1a_0, rdp->other_modes.blend_m1b_0);
-    set_blender_input(rdp, 0, 1, &rdp->blender2a_r[0], &rdp->blender2a_g[0], &rdp->blender2a_b[0], &rdp->blender2b_a[0],
-                      rdp->other_modes.blend_m2a_0, rdp->other_modes.blend_m2b_0);
-    set_blender_input(rdp, 1, 0, &rdp->blender1a_r[1], &rdp->blender1a_g[1], &rdp->blender1a_b[1], &rdp->blender1b_a[1],
-                      rdp->other_modes.blend_m1a_1, rdp->other_modes.blend_m1b_1);
-    set_blender_input(rdp, 1, 1, &rdp->blender2a_r[1], &rdp->blender2a_g[1], &rdp->blender2a_b[1], &rdp->blender2b_a[1],
-                      rdp->other_modes.blend_m2a_1, rdp->other_modes.blend_m2b_1);
+    blender_update(rdp);
 
     rdp->other_modes.f.stalederivs = 1;
 }
@@ -618,3 +687,8 @@ void rdp_cmd(struct rdp_state* rdp, const uint32_t* args)
     uint32_t cmd_id = CMD_ID(args);
     rdp_commands[cmd_id].handler(rdp, args);
 }
+
+uint32_t rdp_cmd_length(uint32_t cmd_id)
+{
+    return rdp_commands[cmd_id & 0x3f].length >> 2;
+}
@@ -59,6 +59,18 @@ static STRICTINLINE bool rdram_valid_idx32(uint32_t in)
     return in <= idxlim32;
 }
 
+// checks if count indices starting at index in are all inside RDRAM, so span
+// and bulk accesses can use the unchecked _fast functions for them
+static STRICTINLINE bool rdram_valid_range16(uint32_t in, uint32_t count)
+{
+    return in <= idxlim16 && count <= idxlim16 - in + 1;
+}
+
+static STRICTINLINE bool rdram_valid_range32(uint32_t in, uint32_t count)
+{
+    return in <= idxlim32 && count <= idxlim32 - in + 1;
+}
+
 static STRICTINLINE uint8_t rdram_read_idx8(uint32_t in)
 {
     in &= RDRAM_MASK;
@@ -127,6 +139,12 @@ static STRICTINLINE void rdram_read_pair16(uint16_t* rdst, uint8_t* hdst, uint32
     }
 }
 
+static STRICTINLINE void rdram_read_pair16_fast(uint16_t* rdst, uint8_t* hdst, uint32_t in)
+{
+    *rdst = rdram16[in ^ WORD_ADDR_XOR];
+    *hdst = rdram_hidden[in];
+}
+
 static STRICTINLINE void rdram_write_pair8(uint32_t in, uint8_t rval, uint8_t hval)
 {
     in &= RDRAM_MASK;
@@ -147,6 +165,12 @@ static STRICTINLINE void rdram_write_pair16(uint32_t in, uint16_t rval, uint8_t
     }
 }
 
+static STRICTINLINE void rdram_write_pair16_fast(uint32_t in, uint16_t rval, uint8_t hval)
+{
+    rdram16[in ^ WORD_ADDR_XOR] = rval;
+    rdram_hidden[in] = hval;
+}
+
 static STRICTINLINE void rdram_write_pair32(uint32_t in, uint32_t rval, uint8_t hval0, uint8_t hval1)
 {
     in &= RDRAM_MASK >> 2;
@@ -156,3 +180,43 @@ static STRICTINLINE void rdram_write_pair32(uint32_t in, uint32_t rval, uint8_t
         rdram_hidden[(in << 1) + 1] = hval1;
     }
 }
+
+static STRICTINLINE void rdram_write_pair32_fast(uint32_t in, uint32_t rval, uint8_t hval0, uint8_t hval1)
+{
+    rdram32[in] = rval;
+    rdram_hidden[in << 1] = hval0;
+    rdram_hidden[(in << 1) + 1] = hval1;
+}
+
+// writes the same pair to count 32 bit indices, the range must have been
+// validated with rdram_valid_range32
+static STRICTINLINE void rdram_fill_pair32(uint32_t in, uint32_t count, uint32_t rval, uint8_t hval0, uint8_t hval1)
+{
+    uint32_t* dst = &rdram32[in];
+    uint8_t* hdst = &rdram_hidden[in << 1];
+    uint32_t i = 0;
+
+#if defined(SIMD_SSE2)
+    __m128i vr = _mm_set1_epi32(rval);
+    __m128i vh = _mm_set1_epi16(hval0 | (hval1 << 8));
+    for (; i + 8 <= count; i += 8) {
+        _mm_storeu_si128((__m128i*)&dst[i], vr);
+        _mm_storeu_si128((__m128i*)&dst[i + 4], vr);
+        _mm_storeu_si128((__m128i*)&hdst[i << 1], vh);
+    }
+#elif defined(SIMD_NEON)
+    uint32x4_t vr = vdupq_n_u32(rval);
+    uint16x8_t vh = vdupq_n_u16(hval0 | (hval1 << 8));
+    for (; i + 8 <= count; i += 8) {
+        vst1q_u32(&dst[i], vr);
+        vst1q_u32(&dst[i + 4], vr);
+        vst1q_u8(&hdst[i << 1], vreinterpretq_u8_u16(vh));
+    }
+#endif
+
+    for (; i < count; i++) {
+        dst[i] = rval;
+        hdst[i << 1] = hval0;
+        hdst[(i << 1) + 1] = hval1;
+    }
+}
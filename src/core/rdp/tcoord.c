@@ -28,9 +28,7 @@ static void (*tcdiv_func[2])(int32_t, int32_t, int32_t, int32_t*, int32_t*) =
     tcdiv_nopersp, tcdiv_persp
 };
 
-static int32_t maskbits_table[16];
 static int32_t log2table[256];
-static int32_t tcdiv_table[0x8000];
 
 static STRICTINLINE void tcmask_copy(struct rdp_state* rdp, int32_t* S, int32_t* S1, int32_t* S2, int32_t* S3, int32_t* T, int32_t num)
 {
@@ -57,7 +55,7 @@ static STRICTINLINE void tcmask_copy(struct rdp_state* rdp, int32_t* S, int32_t*
             *S3 ^= (-wrap);
         }
 
-        maskbits_s = maskbits_table[rdp->tile[num].mask_s];
+        maskbits_s = rdp->tile[num].f.maskbitss;
         *S &= maskbits_s;
         *S1 &= maskbits_s;
         *S2 &= maskbits_s;
@@ -73,54 +71,24 @@ static STRICTINLINE void tcmask_copy(struct rdp_state* rdp, int32_t* S, int32_t*
             *T ^= (-wrap);
         }
 
-        *T &= maskbits_table[rdp->tile[num].mask_t];
+        *T &= rdp->tile[num].f.maskbitst;
     }
 }
 
 
-static STRICTINLINE void tcshift_cycle(struct rdp_state* rdp, int32_t* S, int32_t* T, int32_t* maxs, int32_t* maxt, uint32_t num)
+// shifts a texture coordinate with the precomputed shifts of its tile
+static STRICTINLINE int32_t tcshift_coord(int32_t coord, int32_t shiftl, int32_t shiftr)
 {
+    return SIGN16((uint32_t)coord << shiftl) >> shiftr;
+}
 
+static STRICTINLINE void tcshift_cycle(struct rdp_state* rdp, int32_t* S, int32_t* T, int32_t* maxs, int32_t* maxt, uint32_t num)
+{
+    *S = tcshift_coord(*S, rdp->tile[num].f.shiftls, rdp->tile[num].f.shiftrs);
+    *maxs = ((*S >> 3) >= rdp->tile[num].sh);
 
-
-    int32_t coord = *S;
-    int32_t shifter = rdp->tile[num].shift_s;
-
-
-    if (shifter < 11)
-    {
-        coord = SIGN16(coord);
-        coord >>= shifter;
-    }
-    else
-    {
-        coord <<= (16 - shifter);
-        coord = SIGN16(coord);
-    }
-    *S = coord;
-
-
-
-
-    *maxs = ((coord >> 3) >= rdp->tile[num].sh);
-
-
-
-    coord = *T;
-    shifter = rdp->tile[num].shift_t;
-
-    if (shifter < 11)
-    {
-        coord = SIGN16(coord);
-        coord >>= shifter;
-    }
-    else
-    {
-        coord <<= (16 - shifter);
-        coord = SIGN16(coord);
-    }
-    *T = coord;
-    *maxt = ((coord >> 3) >= rdp->tile[num].th);
+    *T = tcshift_coord(*T, rdp->tile[num].f.shiftlt, rdp->tile[num].f.shiftrt);
+    *maxt = ((*T >> 3) >= rdp->tile[num].th);
 }
 
 static STRICTINLINE void tcclamp_cycle(struct rdp_state* rdp, int32_t* S, int32_t* T, int32_t* SFRAC, int32_t* TFRAC, int32_t maxs, int32_t maxt, int32_t num)
@@ -198,36 +166,8 @@ static STRICTINLINE void tcclamp_cycle_light(struct rdp_state* rdp, int32_t* S,
 
 static STRICTINLINE void tcshift_copy(struct rdp_state* rdp, int32_t* S, int32_t* T, uint32_t num)
 {
-    int32_t coord = *S;
-    int32_t shifter = rdp->tile[num].shift_s;
-
-    if (shifter < 11)
-    {
-        coord = SIGN16(coord);
-        coord >>= shifter;
-    }
-    else
-    {
-        coord <<= (16 - shifter);
-        coord = SIGN16(coord);
-    }
-    *S = coord;
-
-    coord = *T;
-    shifter = rdp->tile[num].shift_t;
-
-    if (shifter < 11)
-    {
-        coord = SIGN16(coord);
-        coord >>= shifter;
-    }
-    else
-    {
-        coord <<= (16 - shifter);
-        coord = SIGN16(coord);
-    }
-    *T = coord;
-
+    *S = tcshift_coord(*S, rdp->tile[num].f.shiftls, rdp->tile[num].f.shiftrs);
+    *T = tcshift_coord(*T, rdp->tile[num].f.shiftlt, rdp->tile[num].f.shiftrt);
 }
 
 
@@ -389,7 +329,7 @@ static STRICTINLINE void lodfrac_lodtile_signals(struct rdp_state* rdp, int lodc
     *lfdst = lf;
 }
 
-static STRICTINLINE void tclod_2cycle(struct rdp_state* rdp, int32_t* sss, int32_t* sst, int32_t s, int32_t t, int32_t w, int32_t dsinc, int32_t dtinc, int32_t dwinc, int32_t prim_tile, int32_t* t1, int32_t* t2, int32_t* lf)
+static STRICTINLINE void tclod_2cycle(struct rdp_state* rdp, int32_t* sss, int32_t* sst, int32_t s, int32_t t, int32_t w, int32_t dsinc, int32_t dtinc, int32_t dwinc, int32_t prim_tile, int32_t* t1, int32_t* t2, int32_t* lf, int dolod)
 {
 
 
@@ -409,7 +349,7 @@ static STRICTINLINE void tclod_2cycle(struct rdp_state* rdp, int32_t* sss, int32
 
     tclod_tcclamp(sss, sst);
 
-    if (rdp->other_modes.f.dolod)
+    if (dolod)
     {
 
         nextsw = (w + dwinc) >> 16;
@@ -466,7 +406,7 @@ static STRICTINLINE void tclod_2cycle(struct rdp_state* rdp, int32_t* sss, int32
     }
 }
 
-static STRICTINLINE void tclod_2cycle_next(struct rdp_state* rdp, int32_t* sss, int32_t* sst, int32_t* sss2, int32_t* sst2, int32_t s, int32_t t, int32_t w, int32_t dsinc, int32_t dtinc, int32_t dwinc, int32_t prim_tile, int32_t* t1, int32_t* t2, int32_t* lf, int scanline)
+static STRICTINLINE void tclod_2cycle_next(struct rdp_state* rdp, int32_t* sss, int32_t* sst, int32_t* sss2, int32_t* sst2, int32_t s, int32_t t, int32_t w, int32_t dsinc, int32_t dtinc, int32_t dwinc, int32_t prim_tile, int32_t* t1, int32_t* t2, int32_t* lf, int scanline, int dolod)
 {
     int nextys, nextyt, nextysw;
     int nexts, nextt, nextsw;
@@ -482,7 +422,7 @@ static STRICTINLINE void tclod_2cycle_next(struct rdp_state* rdp, int32_t* sss,
     tclod_tcclamp(sss, sst);
     tclod_tcclamp(sss2, sst2);
 
-    if (rdp->other_modes.f.dolod)
+    if (dolod)
     {
         int nextscan = scanline + 1;
 
@@ -549,7 +489,7 @@ static STRICTINLINE void tclod_2cycle_next(struct rdp_state* rdp, int32_t* sss,
 }
 
 
-static STRICTINLINE void tclod_2cycle_notexel1(struct rdp_state* rdp, int32_t* sss, int32_t* sst, int32_t s, int32_t t, int32_t w, int32_t dsinc, int32_t dtinc, int32_t dwinc, int32_t prim_tile, int32_t* t1)
+static STRICTINLINE void tclod_2cycle_notexel1(struct rdp_state* rdp, int32_t* sss, int32_t* sst, int32_t s, int32_t t, int32_t w, int32_t dsinc, int32_t dtinc, int32_t dwinc, int32_t prim_tile, int32_t* t1, int dolod)
 {
     int nextys, nextyt, nextysw, nexts, nextt, nextsw;
     int lodclamp = 0;
@@ -561,7 +501,7 @@ static STRICTINLINE void tclod_2cycle_notexel1(struct rdp_state* rdp, int32_t* s
 
     tclod_tcclamp(sss, sst);
 
-    if (rdp->other_modes.f.dolod)
+    if (dolod)
     {
         nextsw = (w + dwinc) >> 16;
         nexts = (s + dsinc) >> 16;
@@ -596,7 +536,7 @@ static STRICTINLINE void tclod_2cycle_notexel1(struct rdp_state* rdp, int32_t* s
     }
 }
 
-static STRICTINLINE void tclod_1cycle_current(struct rdp_state* rdp, int32_t* sss, int32_t* sst, int32_t nexts, int32_t nextt, int32_t s, int32_t t, int32_t w, int32_t dsinc, int32_t dtinc, int32_t dwinc, int32_t scanline, int32_t prim_tile, int32_t* t1, struct spansigs* sigs)
+static STRICTINLINE void tclod_1cycle_current(struct rdp_state* rdp, int32_t* sss, int32_t* sst, int32_t nexts, int32_t nextt, int32_t s, int32_t t, int32_t w, int32_t dsinc, int32_t dtinc, int32_t dwinc, int32_t scanline, int32_t prim_tile, int32_t* t1, struct spansigs* sigs, int dolod)
 {
 
 
@@ -614,7 +554,7 @@ static STRICTINLINE void tclod_1cycle_current(struct rdp_state* rdp, int32_t* ss
 
     tclod_tcclamp(sss, sst);
 
-    if (rdp->other_modes.f.dolod)
+    if (dolod)
     {
         int nextscan = scanline + 1;
 
@@ -679,7 +619,7 @@ static STRICTINLINE void tclod_1cycle_current(struct rdp_state* rdp, int32_t* ss
 
 
 
-static STRICTINLINE void tclod_1cycle_current_simple(struct rdp_state* rdp, int32_t* sss, int32_t* sst, int32_t s, int32_t t, int32_t w, int32_t dsinc, int32_t dtinc, int32_t dwinc, int32_t scanline, int32_t prim_tile, int32_t* t1, struct spansigs* sigs)
+static STRICTINLINE void tclod_1cycle_current_simple(struct rdp_state* rdp, int32_t* sss, int32_t* sst, int32_t s, int32_t t, int32_t w, int32_t dsinc, int32_t dtinc, int32_t dwinc, int32_t scanline, int32_t prim_tile, int32_t* t1, struct spansigs* sigs, int dolod)
 {
     int fars, fart, farsw, nexts, nextt, nextsw;
     int lodclamp = 0;
@@ -688,7 +628,7 @@ static STRICTINLINE void tclod_1cycle_current_simple(struct rdp_state* rdp, int3
 
     tclod_tcclamp(sss, sst);
 
-    if (rdp->other_modes.f.dolod)
+    if (dolod)
     {
 
         int nextscan = scanline + 1;
@@ -755,7 +695,7 @@ static STRICTINLINE void tclod_1cycle_current_simple(struct rdp_state* rdp, int3
     }
 }
 
-static STRICTINLINE void tclod_1cycle_next(struct rdp_state* rdp, int32_t* sss, int32_t* sst, int32_t s, int32_t t, int32_t w, int32_t dsinc, int32_t dtinc, int32_t dwinc, int32_t scanline, int32_t prim_tile, int32_t* t1, struct spansigs* sigs, int32_t* prelodfrac)
+static STRICTINLINE void tclod_1cycle_next(struct rdp_state* rdp, int32_t* sss, int32_t* sst, int32_t s, int32_t t, int32_t w, int32_t dsinc, int32_t dtinc, int32_t dwinc, int32_t scanline, int32_t prim_tile, int32_t* t1, struct spansigs* sigs, int32_t* prelodfrac, int dolod)
 {
     int nexts, nextt, nextsw, fars, fart, farsw;
     int lodclamp = 0;
@@ -764,7 +704,7 @@ static STRICTINLINE void tclod_1cycle_next(struct rdp_state* rdp, int32_t* sss,
 
     tclod_tcclamp(sss, sst);
 
-    if (rdp->other_modes.f.dolod)
+    if (dolod)
     {
 
         int nextscan = scanline + 1;
@@ -1018,12 +958,26 @@ static void tcdiv_nopersp(int32_t ss, int32_t st, int32_t sw, int32_t* sss, int3
     *sst = (SIGN16(st)) & 0x1ffff;
 }
 
-static void tcdiv_persp(int32_t ss, int32_t st, int32_t sw, int32_t* sss, int32_t* sst)
+// normalization shift and reciprocal of w, as the hardware interpolates them
+// from norm_point_table and norm_slope_table
+static STRICTINLINE int32_t tcdiv_rcp(int32_t sw, int32_t* shift)
 {
+    int32_t msb = (sw >> 8) ? log2table[sw >> 8] + 8 : log2table[sw];
+    int32_t normout, wnorm, tempslope;
 
+    *shift = 14 - msb;
+    normout = (sw << *shift) & 0x3fff;
+    wnorm = (normout & 0xff) << 2;
+    normout >>= 8;
 
+    tempslope = (norm_slope_table[normout] | ~0x3ff) + 1;
+    return (((tempslope * wnorm) >> 10) + norm_point_table[normout]) & 0x7fff;
+}
+
+static STRICTINLINE void tcdiv_persp_pixel(int32_t ss, int32_t st, int32_t sw, int32_t* sss, int32_t* sst)
+{
     int w_carry = 0;
-    int shift;
+    int32_t shift;
     int tlu_rcp;
     int sprod, tprod;
     int outofbounds_s, outofbounds_t;
@@ -1031,21 +985,14 @@ static void tcdiv_persp(int32_t ss, int32_t st, int32_t sw, int32_t* sss, int32_
     int shift_value;
     int32_t temps, tempt;
 
-
-
     int overunder_s = 0, overunder_t = 0;
 
-
     if (SIGN16(sw) <= 0)
         w_carry = 1;
 
     sw &= 0x7fff;
 
-
-
-    shift = tcdiv_table[sw];
-    tlu_rcp = shift >> 4;
-    shift &= 0xf;
+    tlu_rcp = tcdiv_rcp(sw, &shift);
 
     sprod = SIGN16(ss) * tlu_rcp;
     tprod = SIGN16(st) * tlu_rcp;
@@ -1096,6 +1043,40 @@ static void tcdiv_persp(int32_t ss, int32_t st, int32_t sw, int32_t* sss, int32_
     *sst = (tempt & 0x1ffff) | overunder_t;
 }
 
+static void tcdiv_persp(int32_t ss, int32_t st, int32_t sw, int32_t* sss, int32_t* sst)
+{
+    tcdiv_persp_pixel(ss, st, sw, sss, sst);
+}
+
+// tcdiv_span divides the texture coordinates of count pixels of a span in
+// advance, starting with the pixel at s, t and w, for the renderers that
+// divide them for every pixel, which saves the indirect call per pixel
+static STRICTINLINE void tcdiv_span(struct rdp_state* rdp, int32_t s, int32_t t, int32_t w, int32_t dsinc, int32_t dtinc, int32_t dwinc, int count)
+{
+    int k;
+
+    if (rdp->other_modes.persp_tex_en)
+    {
+        for (k = 0; k < count; k++)
+        {
+            tcdiv_persp_pixel(s >> 16, t >> 16, w >> 16, &rdp->span_tcs[k], &rdp->span_tct[k]);
+            s += dsinc;
+            t += dtinc;
+            w += dwinc;
+        }
+    }
+    else
+    {
+        for (k = 0; k < count; k++)
+        {
+            rdp->span_tcs[k] = SIGN16(s >> 16) & 0x1ffff;
+            rdp->span_tct[k] = SIGN16(t >> 16) & 0x1ffff;
+            s += dsinc;
+            t += dtinc;
+        }
+    }
+}
+
 static void tcoord_init_lut(void)
 {
     int i, k;
@@ -1112,36 +1093,6 @@ static void tcoord_init_lut(void)
             }
         }
     }
-
-    int temppoint, tempslope;
-    int normout;
-    int wnorm;
-    int shift, tlu_rcp;
-
-    for (i = 0; i < 0x8000; i++)
-    {
-        for (k = 1; k <= 14 && !((i << k) & 0x8000); k++)
-            ;
-        shift = k - 1;
-        normout = (i << shift) & 0x3fff;
-        wnorm = (normout & 0xff) << 2;
-        normout >>= 8;
-
-
-
-        temppoint = norm_point_table[normout];
-        tempslope = norm_slope_table[normout];
-
-        tempslope = (tempslope | ~0x3ff) + 1;
-
-        tlu_rcp = (((tempslope * wnorm) >> 10) + temppoint) & 0x7fff;
-
-        tcdiv_table[i] = shift | (tlu_rcp << 4);
-    }
-
-    maskbits_table[0] = 0x3ff;
-    for (i = 1; i < 16; i++)
-        maskbits_table[i] = ((uint16_t)(0xffff) >> (16 - i)) & 0x3ff;
 }
 
 static void tcoord_init(struct rdp_state* rdp)
@@ -12,7 +12,7 @@ static STRICTINLINE void tcmask(struct rdp_state* rdp, int32_t* S, int32_t* T, i
             wrap &= 1;
             *S ^= (-wrap);
         }
-        *S &= maskbits_table[rdp->tile[num].mask_s];
+        *S &= rdp->tile[num].f.maskbitss;
     }
 
     if (rdp->tile[num].mask_t)
@@ -24,7 +24,7 @@ static STRICTINLINE void tcmask(struct rdp_state* rdp, int32_t* S, int32_t* T, i
             *T ^= (-wrap);
         }
 
-        *T &= maskbits_table[rdp->tile[num].mask_t];
+        *T &= rdp->tile[num].f.maskbitst;
     }
 }
 
@@ -38,7 +38,7 @@ static STRICTINLINE void tcmask_coupled(struct rdp_state* rdp, int32_t* S, int32
 
     if (rdp->tile[num].mask_s)
     {
-        maskbits = maskbits_table[rdp->tile[num].mask_s];
+        maskbits = rdp->tile[num].f.maskbitss;
 
         if (rdp->tile[num].ms)
         {
@@ -68,7 +68,7 @@ static STRICTINLINE void tcmask_coupled(struct rdp_state* rdp, int32_t* S, int32
 
     if (rdp->tile[num].mask_t)
     {
-        maskbits = maskbits_table[rdp->tile[num].mask_t];
+        maskbits = rdp->tile[num].f.maskbitst;
 
         if (rdp->tile[num].mt)
         {
@@ -110,6 +110,15 @@ static INLINE void calculate_tile_derivs(struct tile* t)
     t->f.clampent = t->ct || !t->mask_t;
     t->f.masksclamped = t->mask_s <= 10 ? t->mask_s : 10;
     t->f.masktclamped = t->mask_t <= 10 ? t->mask_t : 10;
+    t->f.maskbitss = t->mask_s ? ((0xffff >> (16 - t->mask_s)) & 0x3ff) : 0x3ff;
+    t->f.maskbitst = t->mask_t ? ((0xffff >> (16 - t->mask_t)) & 0x3ff) : 0x3ff;
+
+    // shifts below 11 are right shifts, all others are left shifts by 16
+    // minus the shift
+    t->f.shiftls = t->shift_s < 11 ? 0 : 16 - t->shift_s;
+    t->f.shiftrs = t->shift_s < 11 ? t->shift_s : 0;
+    t->f.shiftlt = t->shift_t < 11 ? 0 : 16 - t->shift_t;
+    t->f.shiftrt = t->shift_t < 11 ? t->shift_t : 0;
     t->f.notlutswitch = (t->format << 2) | t->size;
     t->f.tlutswitch = (t->size << 2) | ((t->format + 2) & 3);
 
@@ -125,17 +134,15 @@ static INLINE void calculate_tile_derivs(struct tile* t)
     }
 }
 
-static STRICTINLINE void get_texel1_1cycle(struct rdp_state* rdp, int32_t* s1, int32_t* t1, int32_t s, int32_t t, int32_t w, int32_t dsinc, int32_t dtinc, int32_t dwinc, int32_t scanline, struct spansigs* sigs)
+static STRICTINLINE void get_texel1_1cycle(struct rdp_state* rdp, int32_t* s1, int32_t* t1, int32_t j, int32_t scanline, struct spansigs* sigs)
 {
     int32_t nexts, nextt, nextsw;
 
     if (!sigs->endspan || !sigs->longspan || !rdp->span[scanline + 1].validline)
     {
-
-
-        nextsw = (w + dwinc) >> 16;
-        nexts = (s + dsinc) >> 16;
-        nextt = (t + dtinc) >> 16;
+        // the next pixel of the span, divided in advance by tcdiv_span
+        *s1 = rdp->span_tcs[j + 1];
+        *t1 = rdp->span_tct[j + 1];
     }
     else
     {
@@ -150,9 +157,9 @@ static STRICTINLINE void get_texel1_1cycle(struct rdp_state* rdp, int32_t* s1, i
         nextt = rdp->span[nextscan].t >> 16;
         nexts = rdp->span[nextscan].s >> 16;
         nextsw = rdp->span[nextscan].w >> 16;
-    }
 
-    rdp->tcdiv_ptr(nexts, nextt, nextsw, s1, t1);
+        rdp->tcdiv_ptr(nexts, nextt, nextsw, s1, t1);
+    }
 }
 
 static STRICTINLINE void texture_pipeline_cycle(struct rdp_state* rdp, struct color* TEX, struct color* prev, int32_t SSS, int32_t SST, uint32_t tilenum, uint32_t cycle)
@@ -503,7 +510,8 @@ static void loading_pipeline(struct rdp_state* rdp, int start, int end, int tile
     int dswap = 0;
     uint32_t readval0, readval1, readval2, readval3;
     uint32_t readidx32;
-    uint64_t loadqword;
+    uint64_t loadqword, hiqword, loqword;
+    int qshift, inrdram;
     uint16_t tempshort;
     int tmem_formatting = 0;
     uint32_t bit3fl = 0, hibit = 0;
@@ -564,6 +572,15 @@ static void loading_pipeline(struct rdp_state* rdp, int start, int end, int tile
 
         length = (xstart - xend + 1) & 0xfff;
 
+        // check all RDRAM words that are read for the span at once
+        inrdram = 0;
+        if (length && tiptr >= 0)
+        {
+            uint32_t first = ((uint32_t)tiptr >> 2) & ~1;
+            uint32_t last = ((((uint32_t)tiptr + ((length - 1) / spanadvance) * tiadvance) >> 2) & ~1) + 3;
+            inrdram = rdram_valid_range32(first, last - first + 1);
+        }
+
         for (j = 0; j < length; j+= spanadvance)
         {
             ss = s >> 16;
@@ -585,67 +602,40 @@ static void loading_pipeline(struct rdp_state* rdp, int start, int end, int tile
 
             get_tmem_idx(rdp, sss, sst, tilenum, &tmemidx0, &tmemidx1, &tmemidx2, &tmemidx3, &bit3fl, &hibit);
 
+            // each step reads the 64 bit big endian word at tiptr from the two
+            // aligned words around it, or a single repeated TLUT entry
             readidx32 = (tiptr >> 2) & ~1;
-            RREADIDX32(readval0, readidx32);
-            readidx32++;
-            RREADIDX32(readval1, readidx32);
-            readidx32++;
-            RREADIDX32(readval2, readidx32);
-            readidx32++;
-            RREADIDX32(readval3, readidx32);
+            if (inrdram)
+            {
+                readval0 = rdram_read_idx32_fast(readidx32);
+                readval1 = rdram_read_idx32_fast(readidx32 + 1);
+                readval2 = rdram_read_idx32_fast(readidx32 + 2);
+                readval3 = rdram_read_idx32_fast(readidx32 + 3);
+            }
+            else
+            {
+                RREADIDX32(readval0, readidx32);
+                readidx32++;
+                RREADIDX32(readval1, readidx32);
+                readidx32++;
+                RREADIDX32(readval2, readidx32);
+                readidx32++;
+                RREADIDX32(readval3, readidx32);
+            }
 
+            hiqword = ((uint64_t)readval0 << 32) | readval1;
+            loqword = ((uint64_t)readval2 << 32) | readval3;
+            qshift = (tiptr & 7) << 3;
 
-            switch(tiptr & 7)
+            if (ltlut && !(qshift & 8))
             {
-            case 0:
-                if (!ltlut)
-                    loadqword = ((uint64_t)readval0 << 32) | readval1;
-                else
-                {
-                    tempshort = readval0 >> 16;
-                    loadqword = ((uint64_t)tempshort << 48) | ((uint64_t) tempshort << 32) | ((uint64_t) tempshort << 16) | tempshort;
-                }
-                break;
-            case 1:
-                loadqword = ((uint64_t)readval0 << 40) | ((uint64_t)readval1 << 8) | (readval2 >> 24);
-                break;
-            case 2:
-                if (!ltlut)
-                    loadqword = ((uint64_t)readval0 << 48) | ((uint64_t)readval1 << 16) | (readval2 >> 16);
-                else
-                {
-                    tempshort = readval0 & 0xffff;
-                    loadqword = ((uint64_t)tempshort << 48) | ((uint64_t) tempshort << 32) | ((uint64_t) tempshort << 16) | tempshort;
-                }
-                break;
-            case 3:
-                loadqword = ((uint64_t)readval0 << 56) | ((uint64_t)readval1 << 24) | (readval2 >> 8);
-                break;
-            case 4:
-                if (!ltlut)
-                    loadqword = ((uint64_t)readval1 << 32) | readval2;
-                else
-                {
-                    tempshort = readval1 >> 16;
-                    loadqword = ((uint64_t)tempshort << 48) | ((uint64_t) tempshort << 32) | ((uint64_t) tempshort << 16) | tempshort;
-                }
-                break;
-            case 5:
-                loadqword = ((uint64_t)readval1 << 40) | ((uint64_t)readval2 << 8) | (readval3 >> 24);
-                break;
-            case 6:
-                if (!ltlut)
-                    loadqword = ((uint64_t)readval1 << 48) | ((uint64_t)readval2 << 16) | (readval3 >> 16);
-                else
-                {
-                    tempshort = readval1 & 0xffff;
-                    loadqword = ((uint64_t)tempshort << 48) | ((uint64_t) tempshort << 32) | ((uint64_t) tempshort << 16) | tempshort;
-                }
-                break;
-            case 7:
-                loadqword = ((uint64_t)readval1 << 56) | ((uint64_t)readval2 << 24) | (readval3 >> 8);
-                break;
+                tempshort = (uint16_t)(hiqword >> (48 - qshift));
+                loadqword = tempshort * 0x0001000100010001ULL;
             }
+            else if (qshift)
+                loadqword = (hiqword << qshift) | (loqword >> (64 - qshift));
+            else
+                loadqword = hiqword;
 
 
             switch(tmem_formatting)
@@ -973,6 +963,45 @@ void rdp_load_tile(struct rdp_state* rdp, const uint32_t* args)
     tile_tlut_common_cs_decoder(rdp, args);
 }
 
+// gets a conservative range of RDRAM bytes that may be read by a texture load
+// command from the given texture image
+static void load_rdram_range(const uint32_t* args, uint32_t ti_address, int ti_width, int ti_size, uint32_t* start, uint32_t* end)
+{
+    uint32_t sl = (args[0] >> 12) & 0xfff;
+    uint32_t tl = (args[0] >>  0) & 0xfff;
+    uint32_t sh = (args[1] >> 12) & 0xfff;
+    uint32_t th = (args[1] >>  0) & 0xfff;
+    uint32_t first_line, last_line;
+
+    if (CMD_ID(args) == CMD_ID_LOAD_BLOCK)
+    {
+        // a single line, starting at texel sl
+        first_line = last_line = tl & 0x3ff;
+    }
+    else
+    {
+        sl >>= 2;
+        sh >>= 2;
+        first_line = tl >> 2;
+        last_line = th >> 2;
+    }
+
+    uint32_t length = (sh - sl + 1) & 0xfff;
+
+    // each step of the loading pipeline reads 16 bytes
+    *start = ti_address + PIXELS_TO_BYTES(ti_width * first_line + sl, ti_size);
+    *end = ti_address + PIXELS_TO_BYTES(ti_width * last_line + sl + length, ti_size) + 16;
+}
+
+// applies a texture load that has already been done by another state, by
+// referencing its resulting TMEM contents instead of loading from RDRAM again
+static void load_shared(struct rdp_state* rdp, const uint32_t* args, uint8_t* tmem)
+{
+    // all load commands update the tile coordinates like Set_Tile_Size
+    rdp_set_tile_size(rdp, args);
+    rdp->tmem = tmem;
+}
+
 void rdp_set_tile(struct rdp_state* rdp, const uint32_t* args)
 {
     int tilenum = (args[1] >> 24) & 0x7;
@@ -1017,6 +1046,8 @@ void rdp_set_convert(struct rdp_state* rdp, const uint32_t* args)
     rdp->k3_tf = (SIGN(k3, 9) << 1) + 1;
     rdp->k4 = (args[1] >> 9) & 0x1ff;
     rdp->k5 = args[1] & 0x1ff;
+
+    combiner_update(rdp);
 }
 
 static void tex_init_lut(void)
@@ -1030,6 +1061,8 @@ static void tex_init(struct rdp_state* rdp)
     int i;
     tcoord_init(rdp);
 
+    rdp->tmem = rdp->tmem_buf;
+
     for (i = 0; i < 8; i++)
     {
         calculate_tile_derivs(&rdp->tile[i]);
@@ -186,11 +186,14 @@ static INLINE void z_build_com_table(void)
     }
 }
 
-static STRICTINLINE void z_store(uint32_t zcurpixel, uint32_t z, int dzpixenc)
+static STRICTINLINE void z_store(uint32_t zcurpixel, uint32_t z, int dzpixenc, int inrdram)
 {
     uint16_t zval = z_com_table[z & 0x3ffff]|(dzpixenc >> 2);
     uint8_t hval = dzpixenc & 3;
-    PAIRWRITE16(zcurpixel, zval, hval);
+    if (inrdram)
+        rdram_write_pair16_fast(zcurpixel, zval, hval);
+    else
+        PAIRWRITE16(zcurpixel, zval, hval);
 }
 
 static STRICTINLINE uint32_t dz_decompress(uint32_t dz_compressed)
@@ -213,7 +216,7 @@ static STRICTINLINE uint32_t dz_compress(uint32_t value)
     return j;
 }
 
-static STRICTINLINE uint32_t z_compare(struct rdp_state* rdp, uint32_t zcurpixel, uint32_t sz, uint16_t dzpix, int dzpixenc, uint32_t* blend_en, uint32_t* prewrap, uint32_t* curpixel_cvg, uint32_t curpixel_memcvg)
+static STRICTINLINE uint32_t z_compare(struct rdp_state* rdp, int z_compare_en, uint32_t zcurpixel, uint32_t sz, uint16_t dzpix, int dzpixenc, uint32_t* blend_en, uint32_t* prewrap, uint32_t* curpixel_cvg, uint32_t curpixel_memcvg, int inrdram)
 {
 
 
@@ -225,9 +228,12 @@ static STRICTINLINE uint32_t z_compare(struct rdp_state* rdp, uint32_t zcurpixel
     uint32_t oz, dzmem;
     int32_t rawdzmem;
 
-    if (rdp->other_modes.z_compare_en)
+    if (z_compare_en)
     {
-        PAIRREAD16(zval, hval, zcurpixel);
+        if (inrdram)
+            rdram_read_pair16_fast(&zval, &hval, zcurpixel);
+        else
+            PAIRREAD16(zval, hval, zcurpixel);
         oz = z_decompress(zval);
         rawdzmem = ((zval & 3) << 2) | hval;
         dzmem = dz_decompress(rawdzmem);
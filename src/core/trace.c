@@ -0,0 +1,236 @@
+#include "trace.h"
+#include "n64video.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TRACE_MAGIC 0x54504c41 // "ALPT"
+#define TRACE_VERSION 1
+
+// number of 32 bit words per page entry in a RDRAM packet, including the index
+#define TRACE_PAGE_WORDS (1 + TRACE_PAGE_SIZE / sizeof(uint32_t))
+
+struct trace_header
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t rdram_size;
+};
+
+// writer states
+static FILE* write_fp;
+static uint8_t* write_shadow;
+static uint32_t* write_pages;
+static uint32_t write_num_pages;
+
+// reader states
+static FILE* read_fp;
+static uint32_t* read_buf;
+static uint32_t read_buf_len;
+
+static void trace_write_packet_header(enum trace_packet_type type, uint32_t size)
+{
+    uint32_t header[2] = { type, size };
+    fwrite(header, sizeof(header), 1, write_fp);
+}
+
+bool trace_write_open(const char* path, uint32_t rdram_size)
+{
+    trace_write_close();
+
+    if (rdram_size > RDRAM_MAX_SIZE || rdram_size % TRACE_PAGE_SIZE) {
+        return false;
+    }
+
+    write_fp = fopen(path, "wb");
+    if (!write_fp) {
+        return false;
+    }
+
+    struct trace_header header;
+    header.magic = TRACE_MAGIC;
+    header.version = TRACE_VERSION;
+    header.rdram_size = rdram_size;
+    fwrite(&header, sizeof(header), 1, write_fp);
+
+    // the shadow copy starts zeroed, so the first RDRAM packet contains all
+    // pages that aren't blank
+    write_num_pages = rdram_size / TRACE_PAGE_SIZE;
+    write_shadow = calloc(rdram_size, 1);
+    write_pages = calloc(write_num_pages, sizeof(uint32_t));
+
+    return true;
+}
+
+bool trace_write_active(void)
+{
+    return write_fp != NULL;
+}
+
+void trace_write_rdram(const uint8_t* rdram)
+{
+    if (!write_fp) {
+        return;
+    }
+
+    // find pages that have been changed since the last RDRAM packet
+    uint32_t num_dirty = 0;
+    for (uint32_t i = 0; i < write_num_pages; i++) {
+        uint32_t offset = i * TRACE_PAGE_SIZE;
+        if (memcmp(write_shadow + offset, rdram + offset, TRACE_PAGE_SIZE)) {
+            memcpy(write_shadow + offset, rdram + offset, TRACE_PAGE_SIZE);
+            write_pages[num_dirty++] = i;
+        }
+    }
+
+    if (!num_dirty) {
+        return;
+    }
+
+    trace_write_packet_header(TRACE_PACKET_RDRAM, num_dirty);
+
+    for (uint32_t i = 0; i < num_dirty; i++) {
+        fwrite(&write_pages[i], sizeof(uint32_t), 1, write_fp);
+        fwrite(rdram + write_pages[i] * TRACE_PAGE_SIZE, TRACE_PAGE_SIZE, 1, write_fp);
+    }
+}
+
+void trace_write_cmd(const uint32_t* words, uint32_t num_words)
+{
+    if (!write_fp || !num_words) {
+        return;
+    }
+
+    trace_write_packet_header(TRACE_PACKET_CMD, num_words);
+    fwrite(words, sizeof(uint32_t), num_words, write_fp);
+}
+
+void trace_write_vi(uint32_t** vi_reg)
+{
+    if (!write_fp) {
+        return;
+    }
+
+    trace_write_packet_header(TRACE_PACKET_VI, VI_NUM_REG);
+    for (uint32_t i = 0; i < VI_NUM_REG; i++) {
+        fwrite(vi_reg[i], sizeof(uint32_t), 1, write_fp);
+    }
+}
+
+void trace_write_close(void)
+{
+    if (write_fp) {
+        fclose(write_fp);
+        write_fp = NULL;
+    }
+
+    if (write_shadow) {
+        free(write_shadow);
+        write_shadow = NULL;
+    }
+
+    if (write_pages) {
+        free(write_pages);
+        write_pages = NULL;
+    }
+}
+
+bool trace_read_open(const char* path, uint32_t* rdram_size)
+{
+    trace_read_close();
+
+    read_fp = fopen(path, "rb");
+    if (!read_fp) {
+        return false;
+    }
+
+    struct trace_header header;
+    if (fread(&header, sizeof(header), 1, read_fp) != 1 ||
+        header.magic != TRACE_MAGIC ||
+        header.version != TRACE_VERSION ||
+        header.rdram_size > RDRAM_MAX_SIZE ||
+        header.rdram_size % TRACE_PAGE_SIZE) {
+        trace_read_close();
+        return false;
+    }
+
+    *rdram_size = header.rdram_size;
+    return true;
+}
+
+enum trace_read_result trace_read_packet(struct trace_packet* packet)
+{
+    if (!read_fp) {
+        return TRACE_READ_ERROR;
+    }
+
+    // the trace may only end between packets
+    uint32_t header[2];
+    size_t num_read = fread(header, sizeof(uint32_t), 2, read_fp);
+    if (num_read != 2) {
+        return num_read == 0 && feof(read_fp) ? TRACE_READ_END : TRACE_READ_ERROR;
+    }
+
+    uint32_t len;
+    switch (header[0]) {
+        case TRACE_PACKET_RDRAM:
+            if (header[1] > RDRAM_MAX_SIZE / TRACE_PAGE_SIZE) {
+                return TRACE_READ_ERROR;
+            }
+            len = header[1] * TRACE_PAGE_WORDS;
+            break;
+        case TRACE_PACKET_CMD:
+            len = header[1];
+            break;
+        case TRACE_PACKET_VI:
+            if (header[1] != VI_NUM_REG) {
+                return TRACE_READ_ERROR;
+            }
+            len = header[1];
+            break;
+        default:
+            return TRACE_READ_ERROR;
+    }
+
+    // grow read buffer if required
+    if (len > read_buf_len) {
+        uint32_t* buf = realloc(read_buf, len * sizeof(uint32_t));
+        if (!buf) {
+            return TRACE_READ_ERROR;
+        }
+        read_buf = buf;
+        read_buf_len = len;
+    }
+
+    if (fread(read_buf, sizeof(uint32_t), len, read_fp) != len) {
+        return TRACE_READ_ERROR;
+    }
+
+    packet->type = header[0];
+    packet->size = header[1];
+    packet->data = read_buf;
+
+    return TRACE_READ_OK;
+}
+
+void trace_read_rewind(void)
+{
+    if (read_fp) {
+        fseek(read_fp, sizeof(struct trace_header), SEEK_SET);
+    }
+}
+
+void trace_read_close(void)
+{
+    if (read_fp) {
+        fclose(read_fp);
+        read_fp = NULL;
+    }
+
+    if (read_buf) {
+        free(read_buf);
+        read_buf = NULL;
+        read_buf_len = 0;
+    }
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// size of a RDRAM page in trace files
+#define TRACE_PAGE_SIZE 0x1000
+
+enum trace_packet_type
+{
+    TRACE_PACKET_RDRAM, // list of RDRAM pages modified since the last packet
+    TRACE_PACKET_CMD,   // command words read by n64video_process_list
+    TRACE_PACKET_VI,    // VI register values at n64video_update_screen
+    TRACE_PACKET_NUM
+};
+
+enum trace_read_result
+{
+    TRACE_READ_OK,      // a packet has been read
+    TRACE_READ_END,     // the end of the trace has been reached
+    TRACE_READ_ERROR    // the trace is truncated or corrupt
+};
+
+struct trace_packet
+{
+    enum trace_packet_type type;
+    // number of command words, modified pages or VI registers
+    uint32_t size;
+    // command words, VI registers or pairs of page index and page contents
+    uint32_t* data;
+};
+
+bool trace_write_open(const char* path, uint32_t rdram_size);
+bool trace_write_active(void);
+void trace_write_rdram(const uint8_t* rdram);
+void trace_write_cmd(const uint32_t* words, uint32_t num_words);
+void trace_write_vi(uint32_t** vi_reg);
+void trace_write_close(void);
+
+bool trace_read_open(const char* path, uint32_t* rdram_size);
+enum trace_read_result trace_read_packet(struct trace_packet* packet);
+void trace_read_rewind(void);
+void trace_read_close(void);
@@ -0,0 +1,16 @@
+#pragma once
+
+#define GIT_BRANCH "master"
+#define GIT_TAG ""
+#define GIT_COMMIT_HASH "0000000000000000000000000000000000000000"
+#define GIT_COMMIT_DATE ""
+
+#define CORE_BASE_NAME "angrylion's RDP Plus"
+
+#ifdef _DEBUG
+#define CORE_NAME CORE_BASE_NAME " " GIT_TAG " (Debug)"
+#else
+#define CORE_NAME CORE_BASE_NAME " " GIT_TAG
+#endif
+
+#define CORE_SIMPLE_NAME "angrylion-plus"
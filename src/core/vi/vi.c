@@ -107,8 +107,10 @@ static void vi_init(void)
     prevwasblank = false;
 }
 
-static void vi_process_full_parallel(uint32_t worker_id)
+static void vi_process_full_parallel(uint32_t state_id, void* arg)
 {
+    (void)arg;
+
     int32_t y;
     struct ccvg viaa_array[0xa10 << 1];
     struct ccvg divot_array[0xa10 << 1];
@@ -135,15 +137,15 @@ static void vi_process_full_parallel(uint32_t worker_id)
 
     pixels = 0;
 
-    int32_t* rstate = &rdp_states[worker_id]->rand_vi;
+    int32_t* rstate = &rdp_states[state_id]->rand_vi;
 
     int32_t y_begin = 0;
     int32_t y_end = vres;
     int32_t y_inc = 1;
 
     if (config.parallel) {
-        y_begin = worker_id;
-        y_inc = parallel_num_workers();
+        y_begin = state_id;
+        y_inc = rdp_num_states;
     }
 
     for (y = y_begin; y < y_end; y += y_inc) {
@@ -442,9 +444,9 @@ static bool vi_process_full(void)
 
     // run filter update in parallel if enabled
     if (config.parallel) {
-        parallel_run(vi_process_full_parallel);
+        parallel_for(rdp_num_states, vi_process_full_parallel, NULL);
     } else {
-        vi_process_full_parallel(0);
+        vi_process_full_parallel(0, NULL);
     }
 
     // finish and send buffer to screen
@@ -474,12 +476,16 @@ static bool vi_process_full(void)
         output_height = output_height * 3 / 4;
     }
 
+    stats_enter(N64VIDEO_STAGE_SCREEN);
     screen_write(&fb, output_height);
+    stats_leave();
     return true;
 }
 
-static void vi_process_fast_parallel(uint32_t worker_id)
+static void vi_process_fast_parallel(uint32_t state_id, void* arg)
 {
+    (void)arg;
+
     int32_t y;
     int32_t y_begin = 0;
     int32_t y_end = vres_raw;
@@ -494,8 +500,8 @@ static void vi_process_fast_parallel(uint32_t worker_id)
     }
 
     if (config.parallel) {
-        y_begin = worker_id;
-        y_inc = parallel_num_workers();
+        y_begin = state_id;
+        y_inc = rdp_num_states;
     }
 
     for (y = y_begin; y < y_end; y += y_inc) {
@@ -503,6 +509,23 @@ static void vi_process_fast_parallel(uint32_t worker_id)
         int32_t line = y * vi_width_low;
         uint32_t* dst = prescale + y * hres_raw;
 
+        // check the whole line once, so the pixel loop can skip the checks
+        // of single indices for lines inside RDRAM
+        bool inrdram;
+        switch (config.vi.mode) {
+            case VI_MODE_COLOR:
+                inrdram = ctrl.type == VI_TYPE_RGBA8888
+                    ? rdram_valid_range32((frame_buffer >> 2) + line, hres_raw)
+                    : rdram_valid_range16((frame_buffer >> 1) + line, hres_raw);
+                break;
+            case VI_MODE_DEPTH:
+                inrdram = rdram_valid_range16((rdp_states[0]->zb_address >> 1) + line, hres_raw);
+                break;
+            default:
+                inrdram = rdram_valid_range16((frame_buffer >> 1) + line, hres_raw);
+                break;
+        }
+
         for (x = 0; x < hres_raw; x++) {
             uint32_t r, g, b;
 
@@ -510,7 +533,8 @@ static void vi_process_fast_parallel(uint32_t worker_id)
                 case VI_MODE_COLOR:
                     switch (ctrl.type) {
                         case VI_TYPE_RGBA5551: {
-                            uint16_t pix = rdram_read_idx16((frame_buffer >> 1) + line + x);
+                            uint32_t idx = (frame_buffer >> 1) + line + x;
+                            uint16_t pix = inrdram ? rdram_read_idx16_fast(idx) : rdram_read_idx16(idx);
                             r = RGBA16_R(pix);
                             g = RGBA16_G(pix);
                             b = RGBA16_B(pix);
@@ -518,7 +542,8 @@ static void vi_process_fast_parallel(uint32_t worker_id)
                         }
 
                         case VI_TYPE_RGBA8888: {
-                            uint32_t pix = rdram_read_idx32((frame_buffer >> 2) + line + x);
+                            uint32_t idx = (frame_buffer >> 2) + line + x;
+                            uint32_t pix = inrdram ? rdram_read_idx32_fast(idx) : rdram_read_idx32(idx);
                             r = RGBA32_R(pix);
                             g = RGBA32_G(pix);
                             b = RGBA32_B(pix);
@@ -529,11 +554,12 @@ static void vi_process_fast_parallel(uint32_t worker_id)
                             return;
                     }
 
-                    gamma_filters(&r, &g, &b, ctrl, &rdp_states[worker_id]->rand_vi);
+                    gamma_filters(&r, &g, &b, ctrl, &rdp_states[state_id]->rand_vi);
                     break;
 
                 case VI_MODE_DEPTH: {
-                    r = g = b = rdram_read_idx16((rdp_states[0]->zb_address >> 1) + line + x) >> 8;
+                    uint32_t idx = (rdp_states[0]->zb_address >> 1) + line + x;
+                    r = g = b = (inrdram ? rdram_read_idx16_fast(idx) : rdram_read_idx16(idx)) >> 8;
                     break;
                 }
 
@@ -541,7 +567,12 @@ static void vi_process_fast_parallel(uint32_t worker_id)
                     // TODO: incorrect for RGBA8888?
                     uint8_t hval;
                     uint16_t pix;
-                    rdram_read_pair16(&pix, &hval, (frame_buffer >> 1) + line + x);
+                    uint32_t idx = (frame_buffer >> 1) + line + x;
+                    if (inrdram) {
+                        rdram_read_pair16_fast(&pix, &hval, idx);
+                    } else {
+                        rdram_read_pair16(&pix, &hval, idx);
+                    }
                     r = g = b = (((pix & 1) << 2) | hval) << 5;
                     break;
                 }
@@ -574,9 +605,9 @@ static bool vi_process_fast(void)
 
     // run filter update in parallel if enabled
     if (config.parallel) {
-        parallel_run(vi_process_fast_parallel);
+        parallel_for(rdp_num_states, vi_process_fast_parallel, NULL);
     } else {
-        vi_process_fast_parallel(0);
+        vi_process_fast_parallel(0, NULL);
     }
 
     // finish and send buffer to screen
@@ -603,7 +634,9 @@ static bool vi_process_fast(void)
         output_height = output_height * 3 / 4;
     }
 
+    stats_enter(N64VIDEO_STAGE_SCREEN);
     screen_write(&fb, output_height);
+    stats_leave();
     return true;
 }
 
@@ -614,9 +647,19 @@ void n64video_update_screen(void)
         msg_error("Invalid VI mode: %d", config.vi.mode);
     }
 
+    // the frame buffer must contain the output of all queued commands
+    cmd_wait();
+
     // parse and check some common registers
     vi_reg_ptr = plugin_get_vi_registers();
 
+    // record RDRAM contents and VI registers for this frame
+    if (trace_write_active()) {
+        n64video_flush();
+        trace_write_rdram(plugin_get_rdram());
+        trace_write_vi(vi_reg_ptr);
+    }
+
     v_start = (*vi_reg_ptr[VI_V_START] >> 16) & 0x3ff;
     h_start = (*vi_reg_ptr[VI_H_START] >> 16) & 0x3ff;
 
@@ -734,15 +777,19 @@ void n64video_update_screen(void)
         maxhpass = hres_clamped ? hres : (hres - 7);
 
         // run filter update in parallel if enabled
+        stats_enter(N64VIDEO_STAGE_VI);
         if (config.vi.mode == VI_MODE_NORMAL) {
             blank = !vi_process_full();
         } else {
             blank = !vi_process_fast();
         }
+        stats_leave();
     }
 
     // render frame to screen or blank screen if the frame is invalid
+    stats_enter(N64VIDEO_STAGE_SCREEN);
     screen_swap(blank);
+    stats_leave();
 }
 
 static void vi_close(void)
@@ -28,12 +28,18 @@
 #define KEY_SCREEN_HEIGHT "ScreenHeight"
 #define KEY_PARALLEL "Parallel"
 #define KEY_NUM_WORKERS "NumWorkers"
+#define KEY_SPIN_COUNT "SpinCount"
+#define KEY_BATCH_MIN_CMDS "BatchMinCommands"
+#define KEY_BATCH_MAX_CMDS "BatchMaxCommands"
+#define KEY_BATCH_LATENCY "BatchLatency"
 
 #define KEY_VI_MODE "ViMode"
 #define KEY_VI_INTERP "ViInterpolation"
 #define KEY_VI_WIDESCREEN "ViWidescreen"
 #define KEY_VI_HIDE_OVERSCAN "ViHideOverscan"
 
+#define KEY_TRACE_PATH "TracePath"
+
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
@@ -51,8 +57,10 @@ static ptr_ConfigOpenSection      ConfigOpenSection = NULL;
 static ptr_ConfigSaveSection      ConfigSaveSection = NULL;
 static ptr_ConfigSetDefaultInt    ConfigSetDefaultInt = NULL;
 static ptr_ConfigSetDefaultBool   ConfigSetDefaultBool = NULL;
+static ptr_ConfigSetDefaultString ConfigSetDefaultString = NULL;
 static ptr_ConfigGetParamInt      ConfigGetParamInt = NULL;
 static ptr_ConfigGetParamBool     ConfigGetParamBool = NULL;
+static ptr_ConfigGetParamString   ConfigGetParamString = NULL;
 
 static bool warn_hle;
 static bool plugin_initialized;
@@ -87,8 +95,10 @@ EXPORT m64p_error CALL PluginStartup(m64p_dynlib_handle _CoreLibHandle, void *Co
     ConfigSaveSection = (ptr_ConfigSaveSection)DLSYM(CoreLibHandle, "ConfigSaveSection");
     ConfigSetDefaultInt = (ptr_ConfigSetDefaultInt)DLSYM(CoreLibHandle, "ConfigSetDefaultInt");
     ConfigSetDefaultBool = (ptr_ConfigSetDefaultBool)DLSYM(CoreLibHandle, "ConfigSetDefaultBool");
+    ConfigSetDefaultString = (ptr_ConfigSetDefaultString)DLSYM(CoreLibHandle, "ConfigSetDefaultString");
     ConfigGetParamInt = (ptr_ConfigGetParamInt)DLSYM(CoreLibHandle, "ConfigGetParamInt");
     ConfigGetParamBool = (ptr_ConfigGetParamBool)DLSYM(CoreLibHandle, "ConfigGetParamBool");
+    ConfigGetParamString = (ptr_ConfigGetParamString)DLSYM(CoreLibHandle, "ConfigGetParamString");
 
     ConfigOpenSection("Video-General", &configVideoGeneral);
     ConfigOpenSection("Video-Angrylion-Plus", &configVideoAngrylionPlus);
@@ -101,10 +111,15 @@ EXPORT m64p_error CALL PluginStartup(m64p_dynlib_handle _CoreLibHandle, void *Co
 
     ConfigSetDefaultBool(configVideoAngrylionPlus, KEY_PARALLEL, config.parallel, "Distribute rendering between multiple processors if True");
     ConfigSetDefaultInt(configVideoAngrylionPlus, KEY_NUM_WORKERS, config.num_workers, "Rendering Workers (0=Use all logical processors)");
+    ConfigSetDefaultInt(configVideoAngrylionPlus, KEY_SPIN_COUNT, config.spin_count, "Number of times idle workers poll for work before they sleep");
+    ConfigSetDefaultInt(configVideoAngrylionPlus, KEY_BATCH_MIN_CMDS, config.batch.min_cmds, "Minimum number of RDP commands per batch");
+    ConfigSetDefaultInt(configVideoAngrylionPlus, KEY_BATCH_MAX_CMDS, config.batch.max_cmds, "Maximum number of RDP commands per batch");
+    ConfigSetDefaultInt(configVideoAngrylionPlus, KEY_BATCH_LATENCY, config.batch.latency, "Rendering time per batch in microseconds (0=Always use the maximum number of commands)");
     ConfigSetDefaultInt(configVideoAngrylionPlus, KEY_VI_MODE, config.vi.mode, "VI mode (0=Filtered, 1=Unfiltered, 2=Depth, 3=Coverage)");
     ConfigSetDefaultInt(configVideoAngrylionPlus, KEY_VI_INTERP, config.vi.interp, "Scaling interpolation type (0=NN, 1=Linear)");
     ConfigSetDefaultBool(configVideoAngrylionPlus, KEY_VI_WIDESCREEN, config.vi.widescreen, "Use anamorphic 16:9 output mode if True");
     ConfigSetDefaultBool(configVideoAngrylionPlus, KEY_VI_HIDE_OVERSCAN, config.vi.hide_overscan, "Hide overscan area in filteded mode if True");
+    ConfigSetDefaultString(configVideoAngrylionPlus, KEY_TRACE_PATH, "", "Record RDP command trace for the retracer to this file (empty=disabled)");
 
     ConfigSaveSection("Video-General");
     ConfigSaveSection("Video-Angrylion-Plus");
@@ -185,10 +200,15 @@ EXPORT int CALL RomOpen (void)
 
     config.parallel = ConfigGetParamBool(configVideoAngrylionPlus, KEY_PARALLEL);
     config.num_workers = ConfigGetParamInt(configVideoAngrylionPlus, KEY_NUM_WORKERS);
+    config.spin_count = ConfigGetParamInt(configVideoAngrylionPlus, KEY_SPIN_COUNT);
+    config.batch.min_cmds = ConfigGetParamInt(configVideoAngrylionPlus, KEY_BATCH_MIN_CMDS);
+    config.batch.max_cmds = ConfigGetParamInt(configVideoAngrylionPlus, KEY_BATCH_MAX_CMDS);
+    config.batch.latency = ConfigGetParamInt(configVideoAngrylionPlus, KEY_BATCH_LATENCY);
     config.vi.mode = ConfigGetParamInt(configVideoAngrylionPlus, KEY_VI_MODE);
     config.vi.interp = ConfigGetParamInt(configVideoAngrylionPlus, KEY_VI_INTERP);
     config.vi.widescreen = ConfigGetParamBool(configVideoAngrylionPlus, KEY_VI_WIDESCREEN);
     config.vi.hide_overscan = ConfigGetParamBool(configVideoAngrylionPlus, KEY_VI_HIDE_OVERSCAN);
+    config.trace.path = ConfigGetParamString(configVideoAngrylionPlus, KEY_TRACE_PATH);
 
     n64video_init(&config);
     return 1;
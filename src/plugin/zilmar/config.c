@@ -15,6 +15,10 @@
 
 #define KEY_GEN_PARALLEL "parallel"
 #define KEY_GEN_NUM_WORKERS "num_workers"
+#define KEY_GEN_SPIN_COUNT "spin_count"
+#define KEY_GEN_BATCH_MIN_CMDS "batch_min_cmds"
+#define KEY_GEN_BATCH_MAX_CMDS "batch_max_cmds"
+#define KEY_GEN_BATCH_LATENCY "batch_latency"
 
 #define KEY_VI_MODE "mode"
 #define KEY_VI_INTERP "interpolation"
@@ -163,6 +167,18 @@ static void config_handle(const char* key, const char* value, const char* sectio
         if (!_strcmpi(key, KEY_GEN_NUM_WORKERS)) {
             config.num_workers = strtoul(value, NULL, 0);
         }
+        if (!_strcmpi(key, KEY_GEN_SPIN_COUNT)) {
+            config.spin_count = strtoul(value, NULL, 0);
+        }
+        if (!_strcmpi(key, KEY_GEN_BATCH_MIN_CMDS)) {
+            config.batch.min_cmds = strtoul(value, NULL, 0);
+        }
+        if (!_strcmpi(key, KEY_GEN_BATCH_MAX_CMDS)) {
+            config.batch.max_cmds = strtoul(value, NULL, 0);
+        }
+        if (!_strcmpi(key, KEY_GEN_BATCH_LATENCY)) {
+            config.batch.latency = strtoul(value, NULL, 0);
+        }
     } else if (!_strcmpi(section, SECTION_VIDEO_INTERFACE)) {
         if (!_strcmpi(key, KEY_VI_MODE)) {
             config.vi.mode = strtol(value, NULL, 0);
@@ -265,6 +281,10 @@ bool config_save(void)
     config_write_section(fp, SECTION_GENERAL);
     config_write_int32(fp, KEY_GEN_PARALLEL, config.parallel);
     config_write_uint32(fp, KEY_GEN_NUM_WORKERS, config.num_workers);
+    config_write_uint32(fp, KEY_GEN_SPIN_COUNT, config.spin_count);
+    config_write_uint32(fp, KEY_GEN_BATCH_MIN_CMDS, config.batch.min_cmds);
+    config_write_uint32(fp, KEY_GEN_BATCH_MAX_CMDS, config.batch.max_cmds);
+    config_write_uint32(fp, KEY_GEN_BATCH_LATENCY, config.batch.latency);
     fputs("\n", fp);
 
     config_write_section(fp, SECTION_VIDEO_INTERFACE);
@@ -0,0 +1,304 @@
+#include "golden.h"
+
+#include "core/headless/headless.h"
+#include "core/headless/replay.h"
+#include "core/parallel.h"
+#include "core/plugin.h"
+#include "core/rdp.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#define GOLDEN_VERSION 1
+
+#define FNV_OFFSET 0xcbf29ce484222325ULL
+#define FNV_PRIME 0x100000001b3ULL
+
+enum golden_hash
+{
+    GOLDEN_HASH_COLOR,  // color image in RDRAM
+    GOLDEN_HASH_DEPTH,  // Z buffer in RDRAM
+    GOLDEN_HASH_HIDDEN, // hidden RDRAM bits of the color image and Z buffer
+    GOLDEN_HASH_NUM
+};
+
+struct checkpoint
+{
+    char type[8];               // "sync", "cmd" or "vi"
+    uint64_t cmd;               // number of commands processed so far
+    uint32_t frame;             // number of frames processed so far
+    uint32_t cmd_id;            // ID of the last command
+    uint64_t hash[GOLDEN_HASH_NUM];
+};
+
+static FILE* golden_fp;
+static enum golden_mode golden_mode;
+static bool golden_every_cmd;
+static bool golden_diverged;
+static uint32_t num_checkpoints;
+static uint32_t last_cmd_id;
+
+// last checkpoint that matched the golden file
+static struct checkpoint last_match;
+
+static uint64_t hash_bytes(uint64_t hash, const uint8_t* data, uint32_t size)
+{
+    // 64 bit FNV-1a
+    for (uint32_t i = 0; i < size; i++) {
+        hash ^= data[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+static uint32_t image_bytes(const struct n64video_image* image)
+{
+    return (image->width * image->height << image->size) >> 1;
+}
+
+static uint64_t hash_rdram(const struct n64video_image* image)
+{
+    uint8_t* rdram = plugin_get_rdram();
+    uint32_t rdram_size = plugin_get_rdram_size();
+    uint32_t size = image_bytes(image);
+
+    // ignore parts of the image outside of RDRAM
+    if (image->address >= rdram_size) {
+        return FNV_OFFSET;
+    }
+    if (size > rdram_size - image->address) {
+        size = rdram_size - image->address;
+    }
+
+    return hash_bytes(FNV_OFFSET, rdram + image->address, size);
+}
+
+static uint64_t hash_hidden(uint64_t hash, const struct n64video_image* image)
+{
+    uint32_t hidden_size;
+    uint8_t* hidden = n64video_get_hidden_rdram(&hidden_size);
+
+    // there are two hidden bits for each 16 bit word in RDRAM
+    uint32_t begin = image->address >> 1;
+    uint32_t size = image_bytes(image) >> 1;
+
+    if (begin >= hidden_size) {
+        return hash;
+    }
+    if (size > hidden_size - begin) {
+        size = hidden_size - begin;
+    }
+
+    return hash_bytes(hash, hidden + begin, size);
+}
+
+static void checkpoint_rdram(struct checkpoint* cp)
+{
+    struct n64video_image color, depth;
+
+    // all commands up to this point must have been executed
+    n64video_flush();
+
+    n64video_get_color_image(&color);
+    n64video_get_depth_image(&depth);
+
+    cp->hash[GOLDEN_HASH_COLOR] = hash_rdram(&color);
+    cp->hash[GOLDEN_HASH_DEPTH] = hash_rdram(&depth);
+    cp->hash[GOLDEN_HASH_HIDDEN] = hash_hidden(hash_hidden(FNV_OFFSET, &color), &depth);
+}
+
+static void checkpoint_vi(struct checkpoint* cp)
+{
+    struct frame_buffer fb;
+
+    memset(cp->hash, 0, sizeof(cp->hash));
+
+    // the headless screen contains a copy of the VI prescale buffer
+    if (headless_get_frame(&fb, NULL)) {
+        cp->hash[GOLDEN_HASH_COLOR] = hash_bytes(FNV_OFFSET, (uint8_t*)fb.pixels,
+            fb.width * fb.height * sizeof(uint32_t));
+        cp->hash[GOLDEN_HASH_DEPTH] = fb.width;
+        cp->hash[GOLDEN_HASH_HIDDEN] = fb.height;
+    }
+}
+
+static void checkpoint_print(FILE* fp, const struct checkpoint* cp)
+{
+    fprintf(fp, "%s %" PRIu64 " %u %02x %016" PRIx64 " %016" PRIx64 " %016" PRIx64 "\n",
+        cp->type, cp->cmd, cp->frame, cp->cmd_id,
+        cp->hash[GOLDEN_HASH_COLOR], cp->hash[GOLDEN_HASH_DEPTH], cp->hash[GOLDEN_HASH_HIDDEN]);
+}
+
+static bool checkpoint_read(FILE* fp, struct checkpoint* cp)
+{
+    return fscanf(fp, "%7s %" SCNu64 " %u %x %" SCNx64 " %" SCNx64 " %" SCNx64,
+        cp->type, &cp->cmd, &cp->frame, &cp->cmd_id,
+        &cp->hash[GOLDEN_HASH_COLOR], &cp->hash[GOLDEN_HASH_DEPTH], &cp->hash[GOLDEN_HASH_HIDDEN]) == 7;
+}
+
+static void checkpoint_diverged(const struct checkpoint* cp, const struct checkpoint* golden)
+{
+    golden_diverged = true;
+
+    if (strcmp(cp->type, golden->type) || cp->cmd != golden->cmd) {
+        fprintf(stderr, "Golden file doesn't match the trace at checkpoint %u: "
+            "expected %s after command %" PRIu64 ", got %s after command %" PRIu64 "\n",
+            num_checkpoints, golden->type, golden->cmd, cp->type, cp->cmd);
+        return;
+    }
+
+    fprintf(stderr, "Output diverged at checkpoint %u (%s after command %" PRIu64 ", frame %u):\n",
+        num_checkpoints, cp->type, cp->cmd, cp->frame);
+
+    static const char* hash_names[2][GOLDEN_HASH_NUM] = {
+        { "color image", "Z buffer", "hidden bits" },
+        { "VI output", "VI output width", "VI output height" }
+    };
+
+    bool vi = !strcmp(cp->type, "vi");
+    for (uint32_t i = 0; i < GOLDEN_HASH_NUM; i++) {
+        if (cp->hash[i] != golden->hash[i]) {
+            fprintf(stderr, "  %s: expected %016" PRIx64 ", got %016" PRIx64 "\n",
+                hash_names[vi][i], golden->hash[i], cp->hash[i]);
+        }
+    }
+
+    if (vi && cp->cmd == last_match.cmd) {
+        fprintf(stderr, "First diverging command: none, the VI output differs from the same RDRAM contents\n");
+    } else if (cp->cmd == last_match.cmd + 1) {
+        fprintf(stderr, "First diverging command: #%" PRIu64 " (ID 0x%02x)\n", cp->cmd, cp->cmd_id);
+    } else {
+        fprintf(stderr, "First diverging command: between #%" PRIu64 " and #%" PRIu64
+            ", use -c to find the exact command\n", last_match.cmd + 1, cp->cmd);
+    }
+}
+
+static void checkpoint(const char* type, const uint32_t* cmd, const struct replay_stats* stats)
+{
+    if (golden_diverged) {
+        return;
+    }
+
+    struct checkpoint cp;
+    memset(&cp, 0, sizeof(cp));
+    strcpy(cp.type, type);
+    cp.cmd = stats->cmds;
+    cp.frame = stats->frames;
+    cp.cmd_id = last_cmd_id;
+
+    if (cmd) {
+        checkpoint_rdram(&cp);
+    } else {
+        checkpoint_vi(&cp);
+    }
+
+    if (golden_mode == GOLDEN_MODE_RECORD) {
+        checkpoint_print(golden_fp, &cp);
+    } else {
+        struct checkpoint golden;
+        if (!checkpoint_read(golden_fp, &golden)) {
+            fprintf(stderr, "Golden file ends before checkpoint %u\n", num_checkpoints);
+            golden_diverged = true;
+        } else if (strcmp(cp.type, golden.type) || cp.cmd != golden.cmd ||
+            memcmp(cp.hash, golden.hash, sizeof(cp.hash))) {
+            checkpoint_diverged(&cp, &golden);
+        } else {
+            last_match = cp;
+        }
+    }
+
+    num_checkpoints++;
+}
+
+static void golden_event(enum replay_event event, const uint32_t* cmd, const struct replay_stats* stats)
+{
+    switch (event) {
+        case REPLAY_EVENT_CMD:
+            last_cmd_id = CMD_ID(cmd);
+            if (CMD_ID(cmd) == CMD_ID_SYNC_FULL) {
+                checkpoint("sync", cmd, stats);
+            } else if (golden_every_cmd) {
+                checkpoint("cmd", cmd, stats);
+            }
+            break;
+        case REPLAY_EVENT_VI:
+            checkpoint("vi", NULL, stats);
+            break;
+    }
+}
+
+bool golden_open(const char* path, enum golden_mode mode, bool every_cmd,
+    const struct n64video_config* config)
+{
+    golden_fp = fopen(path, mode == GOLDEN_MODE_RECORD ? "w" : "r");
+    if (!golden_fp) {
+        return false;
+    }
+
+    golden_mode = mode;
+    golden_every_cmd = every_cmd;
+    golden_diverged = false;
+    num_checkpoints = 0;
+    last_cmd_id = 0;
+    memset(&last_match, 0, sizeof(last_match));
+
+    // the dithering noise depends on the number of workers, so the output is
+    // only reproducible with the same configuration, which is why the actual
+    // number is recorded rather than 0 for all logical processors
+    uint32_t num_workers = config->parallel ? parallel_num_workers() : 1;
+    uint32_t parallel = config->parallel;
+    uint32_t vi_mode = config->vi.mode;
+    uint32_t cmds = every_cmd;
+
+    if (mode == GOLDEN_MODE_RECORD) {
+        fprintf(golden_fp, "golden %u %u %u %u %u\n", GOLDEN_VERSION, parallel, num_workers, vi_mode, cmds);
+    } else {
+        uint32_t version, golden_parallel, golden_workers, golden_vi_mode, golden_cmds;
+        if (fscanf(golden_fp, "golden %u %u %u %u %u", &version, &golden_parallel,
+            &golden_workers, &golden_vi_mode, &golden_cmds) != 5 || version != GOLDEN_VERSION) {
+            fclose(golden_fp);
+            golden_fp = NULL;
+            return false;
+        }
+
+        if (golden_parallel != parallel || golden_workers != num_workers ||
+            golden_vi_mode != vi_mode || golden_cmds != cmds) {
+            fprintf(stderr, "Golden file was recorded with different settings: "
+                "parallel=%u workers=%u vi_mode=%u every_cmd=%u, "
+                "but the replay uses parallel=%u workers=%u vi_mode=%u every_cmd=%u\n",
+                golden_parallel, golden_workers, golden_vi_mode, golden_cmds,
+                parallel, num_workers, vi_mode, cmds);
+            fclose(golden_fp);
+            golden_fp = NULL;
+            return false;
+        }
+    }
+
+    replay_set_callback(golden_event);
+    return true;
+}
+
+bool golden_close(void)
+{
+    replay_set_callback(NULL);
+
+    if (!golden_fp) {
+        return true;
+    }
+
+    if (golden_mode == GOLDEN_MODE_COMPARE && !golden_diverged) {
+        struct checkpoint golden;
+        if (checkpoint_read(golden_fp, &golden)) {
+            fprintf(stderr, "Golden file contains more checkpoints than the trace\n");
+            golden_diverged = true;
+        } else {
+            printf("%u checkpoints match the golden file\n", num_checkpoints);
+        }
+    }
+
+    fclose(golden_fp);
+    golden_fp = NULL;
+
+    return !golden_diverged;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "core/n64video.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+
+enum golden_mode
+{
+    GOLDEN_MODE_RECORD,     // write hashes to the golden file
+    GOLDEN_MODE_COMPARE     // compare hashes with the golden file
+};
+
+// starts hashing the output of the replayed trace. if every_cmd is set, a
+// checkpoint is created after each command instead of each Sync_Full only.
+// must be called after n64video_init. when comparing, returns false if the
+// golden file was recorded with different settings.
+bool golden_open(const char* path, enum golden_mode mode, bool every_cmd,
+    const struct n64video_config* config);
+
+// returns false if the output diverged from the golden file
+bool golden_close(void);
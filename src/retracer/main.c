@@ -0,0 +1,129 @@
+#include "golden.h"
+
+#include "core/headless/headless.h"
+#include "core/headless/replay.h"
+#include "core/n64video.h"
+#include "core/plugin.h"
+#include "core/trace.h"
+#include "core/version.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static void usage(void)
+{
+    fprintf(stderr,
+        "Usage: " CORE_SIMPLE_NAME "-retracer [options] <trace file>\n"
+        "\n"
+        "Options:\n"
+        "  -w <num>   number of rendering workers (0=use all logical processors)\n"
+        "  -s         disable parallel rendering\n"
+        "  -l <num>   number of times to replay the trace\n"
+        "  -m <num>   VI mode (0=Filtered, 1=Unfiltered, 2=Depth, 3=Coverage)\n"
+        "  -o <file>  record the replayed trace to another trace file\n"
+        "  -G <file>  record hashes of the output to a golden file\n"
+        "  -g <file>  compare hashes of the output with a golden file\n"
+        "  -c         hash the output after every command instead of every full sync\n"
+    );
+}
+
+static double time_now(void)
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char** argv)
+{
+    struct n64video_config config;
+    n64video_config_defaults(&config);
+
+    uint32_t loops = 1;
+    const char* trace_path = NULL;
+    const char* golden_path = NULL;
+    enum golden_mode golden_mode = GOLDEN_MODE_COMPARE;
+    bool golden_every_cmd = false;
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        if (arg[0] != '-') {
+            trace_path = arg;
+        } else if (!strcmp(arg, "-s")) {
+            config.parallel = false;
+        } else if (i + 1 < argc && !strcmp(arg, "-w")) {
+            config.num_workers = strtoul(argv[++i], NULL, 0);
+        } else if (i + 1 < argc && !strcmp(arg, "-l")) {
+            loops = strtoul(argv[++i], NULL, 0);
+        } else if (i + 1 < argc && !strcmp(arg, "-m")) {
+            config.vi.mode = strtol(argv[++i], NULL, 0);
+        } else if (i + 1 < argc && !strcmp(arg, "-o")) {
+            config.trace.path = argv[++i];
+        } else if (i + 1 < argc && !strcmp(arg, "-G")) {
+            golden_path = argv[++i];
+            golden_mode = GOLDEN_MODE_RECORD;
+        } else if (i + 1 < argc && !strcmp(arg, "-g")) {
+            golden_path = argv[++i];
+            golden_mode = GOLDEN_MODE_COMPARE;
+        } else if (!strcmp(arg, "-c")) {
+            golden_every_cmd = true;
+        } else {
+            usage();
+            return EXIT_FAILURE;
+        }
+    }
+
+    // golden files cover a single replay only
+    if (!trace_path || (golden_path && loops != 1)) {
+        usage();
+        return EXIT_FAILURE;
+    }
+
+    uint32_t rdram_size;
+    if (!trace_read_open(trace_path, &rdram_size)) {
+        fprintf(stderr, "Can't open trace file %s\n", trace_path);
+        return EXIT_FAILURE;
+    }
+
+    headless_set_rdram_size(rdram_size);
+    n64video_init(&config);
+
+    if (golden_path && !golden_open(golden_path, golden_mode, golden_every_cmd, &config)) {
+        fprintf(stderr, "Can't use golden file %s\n", golden_path);
+        n64video_close();
+        trace_read_close();
+        return EXIT_FAILURE;
+    }
+
+    struct replay_stats stats = { 0 };
+    bool trace_valid = true;
+    double start = time_now();
+
+    for (uint32_t i = 0; i < loops; i++) {
+        replay_reset();
+
+        if (!replay_trace(&stats)) {
+            fprintf(stderr, "Invalid packet in trace file %s\n", trace_path);
+            trace_valid = false;
+            break;
+        }
+    }
+
+    n64video_flush();
+
+    double elapsed = time_now() - start;
+
+    printf("%u frames, %u command lists, %llu command words, %u full syncs\n",
+        stats.frames, stats.lists, (unsigned long long)stats.words, headless_get_num_syncs());
+    printf("%.3f s, %.2f frames per second\n",
+        elapsed, elapsed > 0 ? stats.frames / elapsed : 0.0);
+
+    bool golden_match = golden_close();
+
+    n64video_close();
+    trace_read_close();
+
+    return trace_valid && golden_match ? EXIT_SUCCESS : EXIT_FAILURE;
+}